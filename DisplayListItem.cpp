@@ -0,0 +1,61 @@
+/*
+ * DisplayListItem.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "DisplayListItem.h"
+#include "LayerItem.h"
+#include <QtGui/QPainter>
+#include <QtWidgets/QStyleOptionGraphicsItem>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+DisplayListItem::DisplayListItem(const QList<QGraphicsItem*>& items, QGraphicsItem* parent):
+	QGraphicsItem(parent) {
+
+	record(items);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+DisplayListItem::~DisplayListItem() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void DisplayListItem::record(const QList<QGraphicsItem*>& items) {
+
+	QPainter painter(&_picture);
+
+	for (int i = 0; i < items.size(); i++) {
+		QGraphicsItem* item = items[i];
+		_bounds |= item->sceneBoundingRect();
+
+		painter.save();
+		painter.setTransform(item->sceneTransform());
+		LayerItem* layerItem = dynamic_cast<LayerItem*>(item);
+		if (layerItem) {
+			layerItem->drawAll(&painter);
+		} else {
+			QStyleOptionGraphicsItem option;
+			option.exposedRect = item->boundingRect();
+			option.rect = option.exposedRect.toAlignedRect();
+			item->paint(&painter, &option, 0);
+		}
+		painter.restore();
+	}
+
+	painter.end();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QRectF DisplayListItem::boundingRect() const {
+	return _bounds;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int DisplayListItem::bytes() const {
+	return _picture.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void DisplayListItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* /*option*/, QWidget* /*widget*/) {
+	painter->drawPicture(0, 0, _picture);
+}
@@ -0,0 +1,52 @@
+/*
+ * DisplayListItem.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef DISPLAYLISTITEM_H_
+#define DISPLAYLISTITEM_H_
+
+#include <QtWidgets/QGraphicsItem>
+#include <QtCore/QList>
+#include <QtGui/QPicture>
+
+/////////////////////////////////////////////////////////////////////
+/// @brief Draw the items of one map layer from a recorded display list.
+///
+/// The drawing commands of the items, with their pens, brushes and
+/// vertices, are recorded once into a QPicture, in scene coordinates.
+/// paint() replays the picture under whatever transform the painter
+/// has, so the output is the same as drawing the items themselves,
+/// without building their paths or setting up their pens and brushes
+/// again. LayerItems are recorded in full, without the culling,
+/// clipping and decimation that depend on the view.
+///
+/// The items are not referenced after recording. If they change, make
+/// a new DisplayListItem.
+class DisplayListItem: public QGraphicsItem {
+public:
+	/// Constructor
+	/// @param items The items to record, in stacking order.
+	/// @param parent The parent item.
+	DisplayListItem(const QList<QGraphicsItem*>& items, QGraphicsItem* parent = 0);
+	/// Destructor
+	virtual ~DisplayListItem();
+	/// @return The union of the recorded items' bounding rectangles, in scene coordinates.
+	virtual QRectF boundingRect() const;
+	/// Replay the display list.
+	virtual void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = 0);
+	/// @return The size of the recorded commands, in bytes.
+	int bytes() const;
+
+protected:
+	/// Record the drawing commands of the items.
+	/// @param items The items.
+	void record(const QList<QGraphicsItem*>& items);
+	/// The display list.
+	QPicture _picture;
+	/// The recorded area.
+	QRectF _bounds;
+};
+
+#endif /* DISPLAYLISTITEM_H_ */
@@ -0,0 +1,366 @@
+/*
+ * GeometryCache.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "GeometryCache.h"
+#include "MapLayer.h"
+#include <QtCore/QFileInfo>
+#include <QtCore/QDateTime>
+#include <QtCore/QSaveFile>
+#include <string.h>
+
+/// Identifies a cache file.
+static const char MAGIC[8] = { 'Q', 'M', 'M', 'G', 'E', 'O', 'M', 0 };
+
+/// Change this whenever the layout changes.
+static const quint32 VERSION = 2;
+
+/// Written in native order; reads back differently on the other kind of machine.
+static const quint32 BYTE_ORDER = 0x01020304;
+
+/// The start of the file.
+struct Header {
+	char magic[8];
+	quint32 version;
+	quint32 byteOrder;
+	quint32 layerCount;
+	quint32 reserved;
+	qint64 dbSize;
+	qint64 dbMtime;
+	double xmin;
+	double ymin;
+	double xmax;
+	double ymax;
+};
+
+/// The directory entry for one layer.
+struct LayerEntry {
+	char table[128];
+	char geometryColumn[64];
+	char nameColumn[64];
+	quint64 offset;
+	quint32 points;
+	quint32 polygons;
+	quint32 paths;
+	quint32 vertexCount;
+	quint64 labelBytes;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @return n rounded up to a multiple of 8.
+static quint64 align8(quint64 n) {
+	return (n + 7) & ~(quint64)7;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @return A string from a fixed size, zero padded field.
+/// @param field The field.
+/// @param size The size of the field.
+static std::string fieldString(const char* field, size_t size) {
+	return std::string(field, strnlen(field, size));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @return The key of a layer in GeometryCache::_layers.
+/// @param table The table the layer was read from.
+/// @param geometryColumn The geometry column.
+/// @param nameColumn The label column. Blank if none.
+static std::string layerKey(const std::string& table, const std::string& geometryColumn,
+		const std::string& nameColumn) {
+	// a space cannot appear in an unquoted SQL identifier
+	return table + " " + geometryColumn + " " + nameColumn;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @return True if offsets are in increasing order, and end at a given value.
+/// @param offsets The offsets.
+/// @param n The number of offsets.
+/// @param first The smallest allowed value of the first offset.
+/// @param end The value of the last offset.
+static bool ascending(const quint32* offsets, quint64 n, quint64 first, quint64 end) {
+	if (offsets[0] < first || offsets[n-1] != end) {
+		return false;
+	}
+	for (quint64 i = 1; i < n; i++) {
+		if (offsets[i] < offsets[i-1]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MappedLayer::MappedLayer():
+	_points(0),
+	_polygons(0),
+	_paths(0),
+	_vertices(0),
+	_partStart(0),
+	_partBoxes(0),
+	_labelStart(0),
+	_labels(0) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MappedLayer::~MappedLayer() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QString MappedLayer::label(int n) const {
+	return QString::fromUtf8(_labels + _labelStart[n], _labelStart[n+1] - _labelStart[n]);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QRectF MappedLayer::partRect(int n) const {
+	const double* b = _partBoxes + 4*n;
+	return QRectF(QPointF(b[0], b[1]), QPointF(b[2], b[3]));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+GeometryCache::GeometryCache():
+	_data(0) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+GeometryCache::~GeometryCache() {
+	close();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string GeometryCache::cachePath(const std::string& dbPath) {
+	return dbPath + ".qmmgeo";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool GeometryCache::open(const std::string& dbPath, double xmin, double ymin, double xmax, double ymax) {
+
+	close();
+
+	// the vertices are used as QPointF in place
+	if (sizeof(qreal) != sizeof(double) || sizeof(QPointF) != 2*sizeof(double)) {
+		return false;
+	}
+
+	QFileInfo db(QString::fromStdString(dbPath));
+	_file.setFileName(QString::fromStdString(cachePath(dbPath)));
+	if (!db.exists() || !_file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	qint64 size = _file.size();
+	if (size < (qint64)sizeof(Header)) {
+		close();
+		return false;
+	}
+
+	_data = _file.map(0, size);
+	if (!_data) {
+		close();
+		return false;
+	}
+
+	const Header* header = (const Header*)_data;
+	if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) ||
+			header->version != VERSION ||
+			header->byteOrder != BYTE_ORDER ||
+			header->dbSize != db.size() ||
+			header->dbMtime != db.lastModified().toMSecsSinceEpoch() ||
+			header->xmin > xmin || header->ymin > ymin ||
+			header->xmax < xmax || header->ymax < ymax ||
+			(qint64)(sizeof(Header) + header->layerCount * sizeof(LayerEntry)) > size) {
+		close();
+		return false;
+	}
+
+	const LayerEntry* entries = (const LayerEntry*)(_data + sizeof(Header));
+	for (quint32 i = 0; i < header->layerCount; i++) {
+
+		const LayerEntry& e = entries[i];
+		quint64 parts = e.polygons + e.paths;
+
+		// the sections, as laid out by write()
+		quint64 boxes      = e.offset;
+		quint64 vertices   = boxes + parts * 4 * sizeof(double);
+		quint64 partStart  = vertices + (quint64)e.vertexCount * 2 * sizeof(double);
+		quint64 labelStart = partStart + (parts + 1) * sizeof(quint32);
+		quint64 labels     = labelStart + ((quint64)e.points + 1) * sizeof(quint32);
+		if (e.offset % 8 || labels + e.labelBytes > (quint64)size) {
+			close();
+			return false;
+		}
+
+		// Everything is indexed through the offset tables, so a damaged one
+		// must not point outside its layer.
+		if (!ascending((const quint32*)(_data + partStart), parts + 1, e.points, e.vertexCount) ||
+				!ascending((const quint32*)(_data + labelStart), (quint64)e.points + 1, 0, e.labelBytes)) {
+			close();
+			return false;
+		}
+
+		MappedLayer& layer = _layers[layerKey(
+				fieldString(e.table, sizeof(e.table)),
+				fieldString(e.geometryColumn, sizeof(e.geometryColumn)),
+				fieldString(e.nameColumn, sizeof(e.nameColumn)))];
+		layer._points     = e.points;
+		layer._polygons   = e.polygons;
+		layer._paths      = e.paths;
+		layer._partBoxes  = (const double*)(_data + boxes);
+		layer._vertices   = (const QPointF*)(_data + vertices);
+		layer._partStart  = (const quint32*)(_data + partStart);
+		layer._labelStart = (const quint32*)(_data + labelStart);
+		layer._labels     = (const char*)(_data + labels);
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void GeometryCache::close() {
+	_layers.clear();
+	if (_data) {
+		_file.unmap(_data);
+		_data = 0;
+	}
+	_file.close();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool GeometryCache::isOpen() const {
+	return _data != 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+const MappedLayer* GeometryCache::layer(const std::string& table,
+		const std::string& geometryColumn, const std::string& nameColumn) const {
+
+	std::map<std::string, MappedLayer>::const_iterator i =
+			_layers.find(layerKey(table, geometryColumn, nameColumn));
+	if (i == _layers.end()) {
+		return 0;
+	}
+	return &i->second;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool GeometryCache::write(const std::string& dbPath, double xmin, double ymin, double xmax, double ymax,
+		const std::vector<MapLayer*>& layers) {
+
+	QFileInfo db(QString::fromStdString(dbPath));
+	if (!db.exists()) {
+		return false;
+	}
+
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.byteOrder = BYTE_ORDER;
+	header.layerCount = layers.size();
+	header.dbSize = db.size();
+	header.dbMtime = db.lastModified().toMSecsSinceEpoch();
+	header.xmin = xmin;
+	header.ymin = ymin;
+	header.xmax = xmax;
+	header.ymax = ymax;
+
+	// Flatten each layer, and work out where it will go.
+	std::vector<LayerEntry> entries(layers.size());
+	std::vector<QByteArray> blocks(layers.size());
+	quint64 offset = align8(sizeof(Header) + layers.size() * sizeof(LayerEntry));
+
+	for (unsigned int i = 0; i < layers.size(); i++) {
+
+		MapLayer& layer = *layers[i];
+		if (layer._table.size() >= sizeof(LayerEntry().table) ||
+				layer._geometryColumn.size() >= sizeof(LayerEntry().geometryColumn) ||
+				layer._nameColumn.size() >= sizeof(LayerEntry().nameColumn)) {
+			// it would not be found again
+			return false;
+		}
+
+		std::vector<double> boxes;
+		std::vector<double> vertices;
+		std::vector<quint32> partStart;
+		std::vector<quint32> labelStart;
+		QByteArray labels;
+
+		for (int p = 0; p < layer._points.size(); p++) {
+			vertices.push_back(layer._points[p].x());
+			vertices.push_back(layer._points[p].y());
+			labelStart.push_back(labels.size());
+			labels += layer._labels[p].toUtf8();
+		}
+		labelStart.push_back(labels.size());
+
+		for (int p = 0; p < layer._polygons.size(); p++) {
+			const QPolygonF& poly = layer._polygons[p];
+			QRectF r = poly.boundingRect();
+			boxes.push_back(r.left());
+			boxes.push_back(r.top());
+			boxes.push_back(r.right());
+			boxes.push_back(r.bottom());
+			partStart.push_back(vertices.size() / 2);
+			for (int v = 0; v < poly.size(); v++) {
+				vertices.push_back(poly[v].x());
+				vertices.push_back(poly[v].y());
+			}
+		}
+
+		for (int p = 0; p < layer._paths.size(); p++) {
+			const QPainterPath& path = layer._paths[p];
+			QRectF r = path.controlPointRect();
+			boxes.push_back(r.left());
+			boxes.push_back(r.top());
+			boxes.push_back(r.right());
+			boxes.push_back(r.bottom());
+			partStart.push_back(vertices.size() / 2);
+			for (int v = 0; v < path.elementCount(); v++) {
+				vertices.push_back(path.elementAt(v).x);
+				vertices.push_back(path.elementAt(v).y);
+			}
+		}
+		partStart.push_back(vertices.size() / 2);
+
+		QByteArray& block = blocks[i];
+		block.append((const char*)boxes.data(), boxes.size() * sizeof(double));
+		block.append((const char*)vertices.data(), vertices.size() * sizeof(double));
+		block.append((const char*)partStart.data(), partStart.size() * sizeof(quint32));
+		block.append((const char*)labelStart.data(), labelStart.size() * sizeof(quint32));
+		block.append(labels);
+		block.append(QByteArray(align8(block.size()) - block.size(), 0));
+
+		LayerEntry& e = entries[i];
+		memset(&e, 0, sizeof(e));
+		strncpy(e.table, layer._table.c_str(), sizeof(e.table) - 1);
+		strncpy(e.geometryColumn, layer._geometryColumn.c_str(), sizeof(e.geometryColumn) - 1);
+		strncpy(e.nameColumn, layer._nameColumn.c_str(), sizeof(e.nameColumn) - 1);
+		e.offset = offset;
+		e.points = layer._points.size();
+		e.polygons = layer._polygons.size();
+		e.paths = layer._paths.size();
+		e.vertexCount = vertices.size() / 2;
+		e.labelBytes = labels.size();
+
+		offset += block.size();
+	}
+
+	// QSaveFile renames the finished file into place, so a reader never maps
+	// a partial one.
+	QSaveFile file(QString::fromStdString(cachePath(dbPath)));
+	if (!file.open(QIODevice::WriteOnly)) {
+		return false;
+	}
+
+	quint64 start = sizeof(Header) + layers.size() * sizeof(LayerEntry);
+	file.write((const char*)&header, sizeof(header));
+	if (entries.size()) {
+		file.write((const char*)&entries[0], entries.size() * sizeof(LayerEntry));
+	}
+	file.write(QByteArray(align8(start) - start, 0));
+	for (unsigned int i = 0; i < blocks.size(); i++) {
+		file.write(blocks[i]);
+	}
+
+	return file.commit();
+}
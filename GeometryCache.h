@@ -0,0 +1,134 @@
+/*
+ * GeometryCache.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef GEOMETRYCACHE_H_
+#define GEOMETRYCACHE_H_
+
+#include <QtCore/QFile>
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+#include <QtCore/QString>
+#include <vector>
+#include <map>
+#include <string>
+
+class MapLayer;
+
+/////////////////////////////////////////////////////////////////////
+/// @brief One layer of a GeometryCache, pointing into the mapped file.
+///
+/// The parts are the polygon exterior rings, followed by the linestrings.
+/// Part n has the vertices _vertices[_partStart[n]] up to, but not including,
+/// _vertices[_partStart[n+1]]. The points come first in _vertices.
+class MappedLayer {
+public:
+	/// Constructor
+	MappedLayer();
+	/// Destructor
+	virtual ~MappedLayer();
+	/// @return The label of a point.
+	/// @param n The point number.
+	QString label(int n) const;
+	/// @return The bounding box of a part.
+	/// @param n The part number.
+	QRectF partRect(int n) const;
+	/// The number of points.
+	int _points;
+	/// The number of polygons.
+	int _polygons;
+	/// The number of linestrings.
+	int _paths;
+	/// The vertices.
+	const QPointF* _vertices;
+	/// The first vertex of each part, plus one past the end.
+	const quint32* _partStart;
+	/// The bounding box of each part: xmin, ymin, xmax, ymax.
+	const double* _partBoxes;
+	/// The offset of each point label in _labels, plus one past the end.
+	const quint32* _labelStart;
+	/// The point labels, in UTF-8, not terminated.
+	const char* _labels;
+};
+
+/////////////////////////////////////////////////////////////////////
+/// @brief A flat binary file of decoded map layers, which is memory
+/// mapped and drawn from directly.
+///
+/// Decoding the SpatiaLite BLOBs is most of the cost of starting a map.
+/// The file holds the layers in the form they are drawn in: contiguous
+/// vertex arrays, with tables of part offsets and part bounding boxes, so
+/// that nothing needs to be parsed or copied when it is opened. The pages
+/// are only read from disk as they are drawn, and are shared between the
+/// processes that map the same file.
+///
+/// The file is identified by a magic string and a version, records the
+/// size and modification time of the database it was made from, and the
+/// map extent. Each layer is filed by its table, geometry column and label
+/// column, so a feature which is read differently is not served from it.
+/// The offset tables of each layer are checked when the file is opened, so
+/// a damaged file is rejected rather than read out of bounds. It is written in native byte order, and is rejected on a
+/// machine with a different byte order, or where qreal is not a double.
+///
+/// Layout, with every section 8 byte aligned:
+/// @code
+/// Header
+/// LayerEntry[layerCount]
+/// for each layer:
+///   double  partBoxes[4 * (polygons + paths)]
+///   double  vertices[2 * vertexCount]   (points, then the parts)
+///   quint32 partStart[polygons + paths + 1]
+///   quint32 labelStart[points + 1]
+///   char    labels[labelBytes]
+/// @endcode
+class GeometryCache {
+public:
+	/// Constructor
+	GeometryCache();
+	/// Destructor. The file is unmapped.
+	virtual ~GeometryCache();
+	/// Map a cache file.
+	/// @param dbPath The database the cache must have been made from.
+	/// @param xmin The map extent; the cache must cover it.
+	/// @param ymin The map extent; the cache must cover it.
+	/// @param xmax The map extent; the cache must cover it.
+	/// @param ymax The map extent; the cache must cover it.
+	/// @return True if the file exists, and is current.
+	bool open(const std::string& dbPath, double xmin, double ymin, double xmax, double ymax);
+	/// Unmap the file.
+	void close();
+	/// @return True if a file is mapped.
+	bool isOpen() const;
+	/// @return A layer, or 0 if the table is not in the cache with the same columns.
+	/// @param table The table the layer was read from.
+	/// @param geometryColumn The geometry column.
+	/// @param nameColumn The label column. Blank if none.
+	const MappedLayer* layer(const std::string& table, const std::string& geometryColumn,
+			const std::string& nameColumn) const;
+	/// Write a cache file.
+	/// @param dbPath The database the layers were read from.
+	/// @param xmin The extent of the layers.
+	/// @param ymin The extent of the layers.
+	/// @param xmax The extent of the layers.
+	/// @param ymax The extent of the layers.
+	/// @param layers The layers. Their table and columns identify them.
+	/// @return False if the file could not be written, or a table or column
+	/// name is too long for it.
+	static bool write(const std::string& dbPath, double xmin, double ymin, double xmax, double ymax,
+			const std::vector<MapLayer*>& layers);
+	/// @return The cache path for a database.
+	/// @param dbPath Path to the database.
+	static std::string cachePath(const std::string& dbPath);
+
+protected:
+	/// The mapped file.
+	QFile _file;
+	/// The start of the mapping. 0 if not mapped.
+	uchar* _data;
+	/// The layers, by table, geometry column and label column.
+	std::map<std::string, MappedLayer> _layers;
+};
+
+#endif /* GEOMETRYCACHE_H_ */
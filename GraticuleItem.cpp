@@ -0,0 +1,146 @@
+/*
+ * GraticuleItem.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "GraticuleItem.h"
+#include <QtGui/QPainter>
+#include <QtWidgets/QStyleOptionGraphicsItem>
+#include <math.h>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+GraticuleItem::GraticuleItem(const QRectF& extent, QGraphicsItem* parent):
+	QGraphicsItem(parent),
+	_extent(extent),
+	_view(extent),
+	_pen("grey"),
+	_font("helvetica", 11) {
+
+	_pen.setWidth(0);
+	_delta = spacing(extent);
+
+	// paint() draws only what crosses the exposed area
+	setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+GraticuleItem::~GraticuleItem() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+double GraticuleItem::spacing(const QRectF& viewRect) {
+
+	// try for approx. 5 segments in latitude.
+	double delta = viewRect.height() / 5.0;
+	if (delta < 1.0)
+		return 1.0;
+	if (delta < 2.0)
+		return 2.0;
+	if (delta < 5.0)
+		return 5.0;
+	if (delta < 10.0)
+		return 10.0;
+	if (delta < 30.0)
+		return 15.0;
+	return 30.0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void GraticuleItem::setView(const QRectF& viewRect) {
+
+	_view = viewRect & _extent;
+	_delta = spacing(viewRect);
+	update();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QRectF GraticuleItem::boundingRect() const {
+	return _extent;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+const QStaticText& GraticuleItem::label(double value, bool latitude) {
+
+	QHash<double, QStaticText>& labels = latitude ? _latLabels : _lonLabels;
+	QHash<double, QStaticText>::iterator i = labels.find(value);
+	if (i != labels.end()) {
+		return i.value();
+	}
+
+	QString text = QString::number(qAbs(value), 'f', 0);
+	if (value > 0) {
+		text += latitude ? "N" : "E";
+	} else if (value < 0) {
+		text += latitude ? "S" : "W";
+	}
+	QStaticText staticText(text);
+	staticText.setPerformanceHint(QStaticText::AggressiveCaching);
+	staticText.prepare(QTransform(), _font);
+	return labels.insert(value, staticText).value();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void GraticuleItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* /*widget*/) {
+
+	QRectF exposed = option->exposedRect & _extent;
+	if (exposed.isEmpty()) {
+		return;
+	}
+
+	// The lines are counted from the edge of the extent, so that they stay
+	// put as the view moves.
+	painter->setPen(_pen);
+	int first = qMax(0, (int)ceil((exposed.left() - _extent.left()) / _delta));
+	for (int i = first; ; i++) {
+		double x = _extent.left() + i * _delta;
+		if (x > exposed.right()) {
+			break;
+		}
+		painter->drawLine(QPointF(x, exposed.top()), QPointF(x, exposed.bottom()));
+	}
+	first = qMax(0, (int)ceil((exposed.top() - _extent.top()) / _delta));
+	for (int i = first; ; i++) {
+		double y = _extent.top() + i * _delta;
+		if (y > exposed.bottom()) {
+			break;
+		}
+		painter->drawLine(QPointF(exposed.left(), y), QPointF(exposed.right(), y));
+	}
+
+	// The labels are a fixed size in pixels, so they are drawn in device
+	// coordinates, at the mapped position of their anchors.
+	QTransform transform = painter->worldTransform();
+	QRectF deviceExposed = transform.mapRect(exposed);
+	painter->save();
+	painter->resetTransform();
+	painter->setFont(_font);
+	painter->setPen(Qt::black);
+
+	double yOffset = _view.height() * 4 / 180;
+	first = qMax(0, (int)ceil((_view.left() - _extent.left()) / _delta));
+	for (int i = first; ; i++) {
+		double x = _extent.left() + i * _delta;
+		if (x > _view.right()) {
+			break;
+		}
+		const QStaticText& text = label(x, false);
+		QPointF pos = transform.map(QPointF(x, _view.top() + yOffset));
+		if (deviceExposed.intersects(QRectF(pos, text.size()))) {
+			painter->drawStaticText(pos, text);
+		}
+	}
+	first = qMax(0, (int)ceil((_view.top() - _extent.top()) / _delta));
+	for (int i = first; ; i++) {
+		double y = _extent.top() + i * _delta;
+		if (y > _view.bottom()) {
+			break;
+		}
+		const QStaticText& text = label(y, true);
+		QPointF pos = transform.map(QPointF(_view.left(), y));
+		if (deviceExposed.intersects(QRectF(pos, text.size()))) {
+			painter->drawStaticText(pos, text);
+		}
+	}
+
+	painter->restore();
+}
@@ -0,0 +1,68 @@
+/*
+ * GraticuleItem.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef GRATICULEITEM_H_
+#define GRATICULEITEM_H_
+
+#include <QtWidgets/QGraphicsItem>
+#include <QtCore/QHash>
+#include <QtGui/QFont>
+#include <QtGui/QPen>
+#include <QtGui/QStaticText>
+
+/////////////////////////////////////////////////////////////////////
+/// @brief Draw the latitude and longitude grid, and its labels.
+///
+/// The grid is worked out when it is painted: the spacing, 1, 2, 5, 10,
+/// 15 or 30 degrees, comes from the height of the view, and only the
+/// lines that cross the exposed area are drawn. The longitude labels are
+/// placed along the bottom of the view, and the latitude labels along its
+/// left side, at a fixed size in pixels. The text of each label is laid
+/// out once, and kept.
+///
+/// setView() is all that changes when the map is zoomed or panned, so
+/// no items are created or deleted.
+class GraticuleItem: public QGraphicsItem {
+public:
+	/// Constructor
+	/// @param extent The area covered by the grid, in scene coordinates.
+	/// @param parent The parent item.
+	GraticuleItem(const QRectF& extent, QGraphicsItem* parent = 0);
+	/// Destructor
+	virtual ~GraticuleItem();
+	/// Set the span of the view, which sets the grid spacing and places the labels.
+	/// @param viewRect The span of the viewport, in scene coordinates.
+	void setView(const QRectF& viewRect);
+	/// @return The grid spacing for a view, in degrees.
+	/// @param viewRect The span of the viewport, in scene coordinates.
+	static double spacing(const QRectF& viewRect);
+	/// @return The grid extent, in scene coordinates.
+	virtual QRectF boundingRect() const;
+	/// Draw the grid lines and labels which cross the exposed area.
+	virtual void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = 0);
+
+protected:
+	/// @return The laid out text of a label.
+	/// @param value The latitude or longitude.
+	/// @param latitude True for a latitude label, false for longitude.
+	const QStaticText& label(double value, bool latitude);
+	/// The area covered by the grid.
+	QRectF _extent;
+	/// The span of the view, within the extent.
+	QRectF _view;
+	/// The grid spacing, in degrees.
+	double _delta;
+	/// The grid line pen.
+	QPen _pen;
+	/// The label font.
+	QFont _font;
+	/// The laid out longitude labels, by longitude.
+	QHash<double, QStaticText> _lonLabels;
+	/// The laid out latitude labels, by latitude.
+	QHash<double, QStaticText> _latLabels;
+};
+
+#endif /* GRATICULEITEM_H_ */
@@ -0,0 +1,819 @@
+/*
+ * LayerItem.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "LayerItem.h"
+#include <QtGui/QPainter>
+#include <QtWidgets/QStyleOptionGraphicsItem>
+#include <string.h>
+#include <math.h>
+
+/// The default decimation tolerance, in device pixels.
+static const double DECIMATION_PIXELS = 0.5;
+
+/// Decimation is skipped at a zoom level where it would keep more than
+/// this fraction of the vertices.
+static const double DECIMATION_WORTHWHILE = 0.8;
+
+/// No level; the decimated buffers are free.
+static const int NO_LEVEL = -1000;
+
+/// Working space for LayerItem::decimated(), shared by all items, since they
+/// are only painted in the GUI thread. It keeps the size of the largest item
+/// decimated so far, up to DECIMATE_SCRATCH_POINTS.
+static QVector<QPointF> decimateScratch;
+
+/// decimateScratch is freed after use if it holds more points than this.
+static const int DECIMATE_SCRATCH_POINTS = 1 << 20;
+
+/// The clip window extends this fraction of the exposed width and height
+/// beyond each side of it, so that small pans reuse the clipped parts.
+static const double CLIP_MARGIN = 0.5;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+LayerItem::LayerItem(const QVector<QPolygonF>& polygons, QPen pen, QBrush brush,
+		QGraphicsItem* parent):
+	QGraphicsItem(parent),
+	_polygons(true),
+	_pen(pen),
+	_brush(brush),
+	_vertices(0),
+	_partStart(0),
+	_partBoxes(0),
+	_parts(0),
+	_clipping(true),
+	_clipScale(0.0),
+	_decimation(DECIMATION_PIXELS),
+	_paintCount(0),
+	_deviceTransform(true),
+	_deviceActive(false) {
+
+	int vertices = 0;
+	for (int i = 0; i < polygons.size(); i++) {
+		vertices += polygons[i].size();
+	}
+	_ownVertices.reserve(vertices);
+	_ownPartStart.reserve(polygons.size() + 1);
+	_ownPartBoxes.reserve(4 * polygons.size());
+
+	for (int i = 0; i < polygons.size(); i++) {
+		addPart(polygons[i].constData(), polygons[i].size());
+	}
+	_ownPartStart.append(_ownVertices.size());
+
+	setParts(_ownVertices.constData(), _ownPartStart.constData(),
+			_ownPartBoxes.constData(), polygons.size());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+LayerItem::LayerItem(const QVector<QPainterPath>& paths, QPen pen,
+		QGraphicsItem* parent):
+	QGraphicsItem(parent),
+	_polygons(false),
+	_pen(pen),
+	_brush(Qt::NoBrush),
+	_vertices(0),
+	_partStart(0),
+	_partBoxes(0),
+	_parts(0),
+	_clipping(true),
+	_clipScale(0.0),
+	_decimation(DECIMATION_PIXELS),
+	_paintCount(0),
+	_deviceTransform(true),
+	_deviceActive(false) {
+
+	int vertices = 0;
+	for (int i = 0; i < paths.size(); i++) {
+		vertices += paths[i].elementCount();
+	}
+	_ownVertices.reserve(vertices);
+	_ownPartStart.reserve(paths.size() + 1);
+	_ownPartBoxes.reserve(4 * paths.size());
+
+	// The linestrings are a moveTo followed by lineTos, so the
+	// elements are the vertices.
+	QVector<QPointF> v;
+	for (int i = 0; i < paths.size(); i++) {
+		const QPainterPath& path = paths[i];
+		v.resize(path.elementCount());
+		for (int e = 0; e < path.elementCount(); e++) {
+			v[e] = path.elementAt(e);
+		}
+		addPart(v.constData(), v.size());
+	}
+	_ownPartStart.append(_ownVertices.size());
+
+	setParts(_ownVertices.constData(), _ownPartStart.constData(),
+			_ownPartBoxes.constData(), paths.size());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+LayerItem::LayerItem(bool polygons, QPen pen, QBrush brush, QGraphicsItem* parent):
+	QGraphicsItem(parent),
+	_polygons(polygons),
+	_pen(pen),
+	_brush(polygons ? brush : QBrush(Qt::NoBrush)),
+	_vertices(0),
+	_partStart(0),
+	_partBoxes(0),
+	_parts(0),
+	_clipping(true),
+	_clipScale(0.0),
+	_decimation(DECIMATION_PIXELS),
+	_paintCount(0),
+	_deviceTransform(true),
+	_deviceActive(false) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+LayerItem::~LayerItem() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::addPart(const QPointF* v, int n) {
+
+	_ownPartStart.append(_ownVertices.size());
+
+	double xmin = n ? v[0].x() : 0.0;
+	double ymin = n ? v[0].y() : 0.0;
+	double xmax = xmin;
+	double ymax = ymin;
+	for (int i = 0; i < n; i++) {
+		_ownVertices.append(v[i]);
+		xmin = qMin(xmin, v[i].x());
+		ymin = qMin(ymin, v[i].y());
+		xmax = qMax(xmax, v[i].x());
+		ymax = qMax(ymax, v[i].y());
+	}
+	_ownPartBoxes.append(xmin);
+	_ownPartBoxes.append(ymin);
+	_ownPartBoxes.append(xmax);
+	_ownPartBoxes.append(ymax);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::setParts(const QPointF* vertices, const quint32* partStart,
+		const double* partBoxes, int parts) {
+
+	prepareGeometryChange();
+
+	_vertices = vertices;
+	_partStart = partStart;
+	_partBoxes = partBoxes;
+	_parts = parts;
+
+	// Compare the coordinates rather than unite QRectFs, since a
+	// horizontal or vertical line has an empty QRectF.
+	if (parts > 0) {
+		double xmin = partBoxes[0], ymin = partBoxes[1];
+		double xmax = partBoxes[2], ymax = partBoxes[3];
+		for (int n = 1; n < parts; n++) {
+			const double* b = partBoxes + 4*n;
+			xmin = qMin(xmin, b[0]);
+			ymin = qMin(ymin, b[1]);
+			xmax = qMax(xmax, b[2]);
+			ymax = qMax(ymax, b[3]);
+		}
+		_bounds = QRectF(QPointF(xmin, ymin), QPointF(xmax, ymax));
+	} else {
+		_bounds = QRectF();
+	}
+
+	// forget what was made from the old geometry
+	clearDerived();
+
+	// paint() needs the exposed area
+	setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QRectF LayerItem::boundingRect() const {
+	return _bounds;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int LayerItem::parts() const {
+	return _parts;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool LayerItem::polygons() const {
+	return _polygons;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+const QPen& LayerItem::pen() const {
+	return _pen;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+const QBrush& LayerItem::brush() const {
+	return _brush;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::setClipping(bool on) {
+
+	_clipping = on;
+	if (!on) {
+		_clipWindow = QRectF();
+		_clipVertices.clear();
+		_clipPart.clear();
+		_clipStart.clear();
+	}
+	update();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::setDeviceTransform(bool on) {
+	_deviceTransform = on;
+	update();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool LayerItem::deviceTransform() const {
+	return _deviceTransform;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::setDecimation(double pixels) {
+
+	if (pixels != _decimation) {
+		_decimation = pixels;
+		clearDerived();
+		update();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+double LayerItem::decimation() const {
+	return _decimation;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+qint64 LayerItem::derivedBytes() const {
+
+	qint64 bytes = _clipVertices.capacity() * sizeof(QPointF)
+			+ _clipPart.capacity() * sizeof(int)
+			+ _clipStart.capacity() * sizeof(quint32)
+			+ _clipScratch.capacity() * sizeof(QPointF)
+			+ _devicePoints.capacity() * sizeof(QPoint);
+
+	for (int i = 0; i < DECIMATED_LEVELS; i++) {
+		bytes += _decimated[i]._vertices.capacity() * sizeof(QPointF)
+				+ _decimated[i]._partStart.capacity() * sizeof(quint32);
+	}
+
+	return bytes;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+qint64 LayerItem::scratchBytes() {
+	return decimateScratch.capacity() * sizeof(QPointF);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::clearDerived() {
+
+	_clipWindow = QRectF();
+	_clipVertices.clear();
+	_clipPart.clear();
+	_clipStart.clear();
+
+	for (int i = 0; i < DECIMATED_LEVELS; i++) {
+		_decimated[i]._level = NO_LEVEL;
+		_decimated[i]._vertices = QVector<QPointF>();
+		_decimated[i]._partStart = QVector<quint32>();
+		_decimated[i]._used = 0;
+		_decimated[i]._worthwhile = false;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+const LayerItem::Decimated* LayerItem::decimated(double scale) {
+
+	if (_decimation <= 0.0 || _parts == 0 || scale <= 0.0) {
+		return 0;
+	}
+
+	// The power of two at or above the scale, so the tolerance in item
+	// units is never coarser than asked for.
+	int level = (int)ceil(log2(scale));
+
+	Decimated* oldest = &_decimated[0];
+	for (int i = 0; i < DECIMATED_LEVELS; i++) {
+		Decimated& d = _decimated[i];
+		if (d._level == level) {
+			d._used = _paintCount;
+			return d._worthwhile ? &d : 0;
+		}
+		if (d._used < oldest->_used) {
+			oldest = &d;
+		}
+	}
+
+	// Replace the least recently used level. The vertices are decimated into
+	// working space, and only copied if enough of them were dropped, so each
+	// level holds no more than it keeps.
+	Decimated& d = *oldest;
+	d._level = level;
+	d._used = _paintCount;
+	int total = _partStart[_parts] - _partStart[0];
+	if (decimateScratch.size() < total) {
+		decimateScratch.resize(total);
+	}
+	d._partStart.resize(_parts + 1);
+
+	int kept = decimate(level, decimateScratch.data(), d._partStart.data());
+	d._worthwhile = kept <= DECIMATION_WORTHWHILE * total;
+	if (d._worthwhile) {
+		d._vertices.resize(kept);
+		d._vertices.squeeze();
+		memcpy(d._vertices.data(), decimateScratch.constData(), kept * sizeof(QPointF));
+		d._partStart.squeeze();
+	} else {
+		d._vertices = QVector<QPointF>();
+		d._partStart = QVector<quint32>();
+	}
+	if (decimateScratch.capacity() > DECIMATE_SCRATCH_POINTS) {
+		decimateScratch = QVector<QPointF>();
+	}
+	return d._worthwhile ? &d : 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int LayerItem::decimate(int level, QPointF* out, quint32* start) const {
+
+	double tolerance = _decimation / ldexp(1.0, level);
+	double tolerance2 = tolerance * tolerance;
+
+	int kept = 0;
+
+	for (int n = 0; n < _parts; n++) {
+		start[n] = kept;
+		const QPointF* v = _vertices + _partStart[n];
+		int count = _partStart[n+1] - _partStart[n];
+		if (count == 0) {
+			continue;
+		}
+
+		// keep the first and last vertices, and each one which is far
+		// enough from the last one kept
+		out[kept++] = v[0];
+		QPointF last = v[0];
+		for (int i = 1; i < count - 1; i++) {
+			double dx = v[i].x() - last.x();
+			double dy = v[i].y() - last.y();
+			if (dx*dx + dy*dy >= tolerance2) {
+				out[kept++] = v[i];
+				last = v[i];
+			}
+		}
+		if (count > 1) {
+			out[kept++] = v[count-1];
+		}
+	}
+	start[_parts] = kept;
+
+	return kept;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool LayerItem::clipping() const {
+	return _clipping;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::copyParts(QVector<QPointF>& vertices, QVector<quint32>& partStart,
+		QVector<double>& partBoxes) const {
+
+	vertices.clear();
+	partStart.clear();
+	partBoxes.clear();
+
+	if (_parts == 0) {
+		partStart.append(0);
+		return;
+	}
+
+	// a mapped item starts part way through the mapped vertices
+	quint32 first = _partStart[0];
+	quint32 end = _partStart[_parts];
+
+	vertices.resize(end - first);
+	memcpy(vertices.data(), _vertices + first, (end - first) * sizeof(QPointF));
+
+	partStart.resize(_parts + 1);
+	for (int n = 0; n <= _parts; n++) {
+		partStart[n] = _partStart[n] - first;
+	}
+
+	partBoxes.resize(4 * _parts);
+	memcpy(partBoxes.data(), _partBoxes, 4 * _parts * sizeof(double));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::drawAll(QPainter* painter) const {
+
+	painter->setPen(_pen);
+	painter->setBrush(_brush);
+
+	for (int n = 0; n < _parts; n++) {
+		const QPointF* v = _vertices + _partStart[n];
+		int count = _partStart[n+1] - _partStart[n];
+		if (_polygons) {
+			painter->drawPolygon(v, count);
+		} else {
+			painter->drawPolyline(v, count);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::drawParts(QPainter* painter, const QRectF& rect, bool polygons,
+		const QPointF* vertices, const quint32* partStart,
+		const double* partBoxes, int parts) {
+
+	for (int n = 0; n < parts; n++) {
+		const double* b = partBoxes + 4*n;
+		if (b[0] > rect.right() || b[2] < rect.left() ||
+				b[1] > rect.bottom() || b[3] < rect.top()) {
+			continue;
+		}
+		const QPointF* v = vertices + partStart[n];
+		int count = partStart[n+1] - partStart[n];
+		if (polygons) {
+			painter->drawPolygon(v, count);
+		} else {
+			painter->drawPolyline(v, count);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* /*widget*/) {
+
+	painter->setPen(_pen);
+	painter->setBrush(_brush);
+
+	// The device transform includes the device pixel ratio of a high DPI
+	// screen, which the world transform leaves out.
+	QTransform world = painter->worldTransform();
+	QTransform device = painter->deviceTransform();
+
+	QRectF exposed = option->exposedRect;
+	double scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(device);
+	_paintCount++;
+
+	const QPointF* vertices = _vertices;
+	const quint32* partStart = _partStart;
+	const Decimated* d = decimated(scale);
+	if (d) {
+		vertices = d->_vertices.constData();
+		partStart = d->_partStart.constData();
+	}
+
+	// Map to device pixels here, rather than in QPainter, when the result
+	// looks the same: the pen width and brush do not scale with the transform.
+	// Unclipped, the whole item must fit the device coordinates.
+	bool whole = !_clipping || exposed.contains(_bounds);
+	_device = PointTransform(device);
+	_deviceActive = _deviceTransform && _pen.isCosmetic()
+			&& (_brush.style() == Qt::NoBrush || _brush.style() == Qt::SolidPattern)
+			&& device.type() <= QTransform::TxShear && device.isInvertible()
+			&& (!whole || _device.fits(_bounds));
+	if (_deviceActive) {
+		painter->save();
+		// an antialiased one pixel line is sharpest along the pixel centres
+		double centre = painter->testRenderHint(QPainter::Antialiasing) ? 0.5 : 0.0;
+		// The painter applies its own part of the device transform, such as
+		// the device pixel ratio, after the world transform, so that is
+		// divided back out.
+		painter->setWorldTransform(QTransform::fromTranslate(centre, centre) * device.inverted() * world);
+	}
+
+	// nothing is cut off when the whole item is exposed
+	if (whole) {
+		if (_deviceActive) {
+			drawDevice(painter, exposed, vertices, partStart);
+		} else {
+			drawParts(painter, exposed, _polygons, vertices, partStart, _partBoxes, _parts);
+		}
+	} else {
+		if (_clipWindow.isNull() || scale != _clipScale || !_clipWindow.contains(exposed)) {
+			// wide enough that a thick pen drawn along the window edge stays out of sight
+			double pen = _pen.isCosmetic() ? 0.0 : _pen.widthF();
+			double dx = CLIP_MARGIN * exposed.width() + pen;
+			double dy = CLIP_MARGIN * exposed.height() + pen;
+			clip(exposed.adjusted(-dx, -dy, dx, dy), vertices, partStart);
+			_clipScale = scale;
+		}
+		drawClipped(painter, exposed, vertices, partStart);
+	}
+
+	if (_deviceActive) {
+		painter->restore();
+		_deviceActive = false;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::drawDevice(QPainter* painter, const QRectF& rect,
+		const QPointF* vertices, const quint32* partStart) {
+
+	// map the whole layer in one pass
+	quint32 first = partStart[0];
+	int total = partStart[_parts] - first;
+	if (_devicePoints.size() < total) {
+		_devicePoints.resize(total);
+	}
+	QPoint* points = _devicePoints.data();
+	_device.map(vertices + first, total, points);
+
+	for (int n = 0; n < _parts; n++) {
+		const double* b = _partBoxes + 4*n;
+		if (b[0] > rect.right() || b[2] < rect.left() ||
+				b[1] > rect.bottom() || b[3] < rect.top()) {
+			continue;
+		}
+		QPoint* p = points + (partStart[n] - first);
+		int count = PointTransform::dropRepeats(p, partStart[n+1] - partStart[n]);
+		if (_polygons) {
+			painter->drawPolygon(p, count);
+		} else {
+			painter->drawPolyline(p, count);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::drawPart(QPainter* painter, const QPointF* v, int count) {
+
+	if (!_deviceActive) {
+		if (_polygons) {
+			painter->drawPolygon(v, count);
+		} else {
+			painter->drawPolyline(v, count);
+		}
+		return;
+	}
+
+	if (_devicePoints.size() < count) {
+		_devicePoints.resize(count);
+	}
+	QPoint* p = _devicePoints.data();
+	_device.map(v, count, p);
+	count = PointTransform::dropRepeats(p, count);
+	if (_polygons) {
+		painter->drawPolygon(p, count);
+	} else {
+		painter->drawPolyline(p, count);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::clip(const QRectF& window, const QPointF* vertices, const quint32* partStart) {
+
+	_clipWindow = window;
+	_clipVertices.clear();
+	_clipPart.clear();
+	_clipStart.clear();
+
+	for (int n = 0; n < _parts; n++) {
+		int count = partStart[n+1] - partStart[n];
+		if (count < CLIP_VERTICES) {
+			continue;
+		}
+		const double* b = _partBoxes + 4*n;
+		if (b[0] > window.right() || b[2] < window.left() ||
+				b[1] > window.bottom() || b[3] < window.top()) {
+			// culled anyway
+			continue;
+		}
+		if (b[0] >= window.left() && b[2] <= window.right() &&
+				b[1] >= window.top() && b[3] <= window.bottom()) {
+			// nothing to cut off
+			continue;
+		}
+		const QPointF* v = vertices + partStart[n];
+		if (_polygons) {
+			_clipPart.append(n);
+			_clipStart.append(_clipVertices.size());
+			clipPolygon(v, count, window, _clipVertices, _clipScratch);
+		} else {
+			int pieces = _clipPart.size();
+			clipPolyline(v, count, window, n);
+			if (_clipPart.size() == pieces) {
+				// mark it as clipped away
+				_clipPart.append(n);
+				_clipStart.append(_clipVertices.size());
+			}
+		}
+	}
+	_clipStart.append(_clipVertices.size());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::drawClipped(QPainter* painter, const QRectF& rect,
+		const QPointF* vertices, const quint32* partStart) {
+
+	int pieces = _clipPart.size();
+	int c = 0;
+	for (int n = 0; n < _parts; n++) {
+		const double* b = _partBoxes + 4*n;
+		if (b[0] > rect.right() || b[2] < rect.left() ||
+				b[1] > rect.bottom() || b[3] < rect.top()) {
+			continue;
+		}
+
+		while (c < pieces && _clipPart[c] < n) {
+			c++;
+		}
+		if (c < pieces && _clipPart[c] == n) {
+			for (; c < pieces && _clipPart[c] == n; c++) {
+				const QPointF* v = _clipVertices.constData() + _clipStart[c];
+				int count = _clipStart[c+1] - _clipStart[c];
+				if (count > (_polygons ? 2 : 1)) {
+					drawPart(painter, v, count);
+				}
+			}
+			continue;
+		}
+
+		const QPointF* v = vertices + partStart[n];
+		int count = partStart[n+1] - partStart[n];
+		if (_deviceActive && !_device.fits(QRectF(QPointF(b[0], b[1]), QPointF(b[2], b[3])))) {
+			// a long segment, such as a border, at a deep zoom
+			drawCut(painter, v, count);
+			continue;
+		}
+		drawPart(painter, v, count);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::drawCut(QPainter* painter, const QPointF* v, int count) {
+
+	// rare enough that the working space need not be kept
+	QVector<QPointF> out;
+	if (_polygons) {
+		QVector<QPointF> scratch;
+		clipPolygon(v, count, _clipWindow, out, scratch);
+		if (out.size() > 2) {
+			drawPart(painter, out.constData(), out.size());
+		}
+		return;
+	}
+
+	QVector<quint32> starts;
+	clipPolyline(v, count, _clipWindow, out, starts);
+	starts.append(out.size());
+	for (int i = 0; i + 1 < starts.size(); i++) {
+		int n = starts[i+1] - starts[i];
+		if (n > 1) {
+			drawPart(painter, out.constData() + starts[i], n);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @return True if a point is inside one edge of the clip rectangle.
+/// @param p The point.
+/// @param edge 0 to 3 for the left, right, top and bottom edges.
+/// @param r The rectangle.
+static inline bool insideEdge(const QPointF& p, int edge, const QRectF& r) {
+	switch (edge) {
+	case 0:
+		return p.x() >= r.left();
+	case 1:
+		return p.x() <= r.right();
+	case 2:
+		return p.y() >= r.top();
+	default:
+		return p.y() <= r.bottom();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @return The point where a line crosses one edge of the clip rectangle.
+/// @param a The start of the line.
+/// @param b The end of the line.
+/// @param edge 0 to 3 for the left, right, top and bottom edges.
+/// @param r The rectangle.
+static inline QPointF crossEdge(const QPointF& a, const QPointF& b, int edge, const QRectF& r) {
+	if (edge < 2) {
+		double x = edge == 0 ? r.left() : r.right();
+		double t = (x - a.x()) / (b.x() - a.x());
+		return QPointF(x, a.y() + t * (b.y() - a.y()));
+	}
+	double y = edge == 2 ? r.top() : r.bottom();
+	double t = (y - a.y()) / (b.y() - a.y());
+	return QPointF(a.x() + t * (b.x() - a.x()), y);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Clip a closed ring against one edge of a rectangle.
+/// @param v The vertices.
+/// @param n The number of vertices.
+/// @param edge 0 to 3 for the left, right, top and bottom edges.
+/// @param r The rectangle.
+/// @param out The clipped vertices are appended here.
+static void clipEdge(const QPointF* v, int n, int edge, const QRectF& r, QVector<QPointF>& out) {
+
+	if (n == 0) {
+		return;
+	}
+
+	QPointF prev = v[n-1];
+	bool prevInside = insideEdge(prev, edge, r);
+	for (int i = 0; i < n; i++) {
+		const QPointF& p = v[i];
+		bool inside = insideEdge(p, edge, r);
+		if (inside != prevInside) {
+			out.append(crossEdge(prev, p, edge, r));
+		}
+		if (inside) {
+			out.append(p);
+		}
+		prev = p;
+		prevInside = inside;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::clipPolygon(const QPointF* v, int n, const QRectF& r,
+		QVector<QPointF>& out, QVector<QPointF>& scratch) {
+
+	// Clip against each edge in turn, alternating between scratch and the
+	// end of out, so nothing is allocated once both have grown big enough.
+	int base = out.size();
+
+	scratch.clear();
+	clipEdge(v, n, 0, r, scratch);
+	clipEdge(scratch.constData(), scratch.size(), 1, r, out);
+
+	scratch.clear();
+	clipEdge(out.constData() + base, out.size() - base, 2, r, scratch);
+	out.resize(base);
+	clipEdge(scratch.constData(), scratch.size(), 3, r, out);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::clipPolyline(const QPointF* v, int n, const QRectF& r, int part) {
+
+	int pieces = _clipStart.size();
+	clipPolyline(v, n, r, _clipVertices, _clipStart);
+	for (int i = pieces; i < _clipStart.size(); i++) {
+		_clipPart.append(part);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void LayerItem::clipPolyline(const QPointF* v, int n, const QRectF& r,
+		QVector<QPointF>& out, QVector<quint32>& starts) {
+
+	// true while the last piece ends at the previous vertex
+	bool open = false;
+
+	for (int i = 1; i < n; i++) {
+		const QPointF& a = v[i-1];
+		const QPointF& b = v[i];
+		double dx = b.x() - a.x();
+		double dy = b.y() - a.y();
+
+		// the part of the segment a + t(b - a) that is inside r
+		double t0 = 0.0;
+		double t1 = 1.0;
+		double p[4] = { -dx, dx, -dy, dy };
+		double q[4] = { a.x() - r.left(), r.right() - a.x(), a.y() - r.top(), r.bottom() - a.y() };
+		bool visible = true;
+		for (int e = 0; e < 4 && visible; e++) {
+			if (p[e] == 0.0) {
+				visible = q[e] >= 0.0;
+			} else {
+				double t = q[e] / p[e];
+				if (p[e] < 0.0) {
+					t0 = qMax(t0, t);
+				} else {
+					t1 = qMin(t1, t);
+				}
+				visible = t0 <= t1;
+			}
+		}
+
+		if (!visible) {
+			open = false;
+			continue;
+		}
+
+		if (!open || t0 > 0.0) {
+			// start a new piece
+			starts.append(out.size());
+			out.append(QPointF(a.x() + t0 * dx, a.y() + t0 * dy));
+		}
+		out.append(QPointF(a.x() + t1 * dx, a.y() + t1 * dy));
+		open = t1 >= 1.0;
+	}
+}
@@ -0,0 +1,288 @@
+/*
+ * LayerItem.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef LAYERITEM_H_
+#define LAYERITEM_H_
+
+#include <QtWidgets/QGraphicsItem>
+#include <QtCore/QVector>
+#include <QtGui/QPolygonF>
+#include <QtGui/QPainterPath>
+#include <QtGui/QPen>
+#include <QtGui/QBrush>
+#include "PointTransform.h"
+
+/////////////////////////////////////////////////////////////////////
+/// @brief Draw all of the polygons, or all of the linestrings, of
+/// one feature as a single graphics item.
+///
+/// The vertices of every part are kept end to end in one array, with
+/// a bounding box for each part. The scene sees one item instead of
+/// one per geometry, and paint() sets up the pen and brush once and
+/// skips the parts whose bounding box is outside the exposed area.
+///
+/// When zoomed in, a single part, such as a country outline, may have
+/// thousands of vertices outside the exposed area. Parts with at least
+/// CLIP_VERTICES vertices that cross the edge of a clip window, a little
+/// larger than the exposed area, are clipped to it before they are drawn.
+/// The clipped parts are kept, and reused for as long as the exposed area
+/// stays within the window at the same scale.
+///
+/// At small scales, runs of consecutive vertices fall within the same device
+/// pixel. Before drawing, each part is decimated by dropping the vertices
+/// closer than a sub-pixel tolerance to the last one kept. The decimated
+/// geometry is made for a zoom level, the power of two at or above the
+/// current scale, and kept for the last few levels, each in buffers of the
+/// size it needs. A level where hardly any vertices would be dropped keeps
+/// nothing, and the original geometry is drawn instead.
+///
+/// The derived geometry is allocated as it is made. A new decimated level is
+/// decimated into working space shared by all items, which keeps the size of
+/// the largest item up to a limit, and then copied into a buffer of its own
+/// of the exact size, so each change of level allocates once. The clipped parts
+/// and their working space, and the device pixel buffer, keep their capacity
+/// from one paint to the next, so a re-clip or repaint does not allocate once
+/// they have grown. derivedBytes() and scratchBytes() report all of it.
+///
+/// When the pen is cosmetic and the brush plain, so that nothing but the
+/// vertices depends on the transform, paint() maps the vertices to integer
+/// device pixels itself with a PointTransform, drops the repeats, and draws
+/// them under a transform which only divides out the device pixel ratio.
+class LayerItem: public QGraphicsItem {
+public:
+	/// Parts with fewer vertices are drawn without clipping.
+	static const int CLIP_VERTICES = 64;
+	/// The number of zoom levels whose decimated geometry is kept.
+	static const int DECIMATED_LEVELS = 4;
+	/// Constructor
+	/// @param polygons The polygons. They are copied.
+	/// @param pen The edge pen.
+	/// @param brush The fill.
+	/// @param parent The parent item.
+	LayerItem(const QVector<QPolygonF>& polygons, QPen pen, QBrush brush,
+			QGraphicsItem* parent = 0);
+	/// Constructor
+	/// @param paths The linestrings. Their vertices are copied.
+	/// @param pen The line pen.
+	/// @param parent The parent item.
+	LayerItem(const QVector<QPainterPath>& paths, QPen pen,
+			QGraphicsItem* parent = 0);
+	/// Destructor
+	virtual ~LayerItem();
+	/// @return The union of the part bounding boxes.
+	virtual QRectF boundingRect() const;
+	/// Draw the parts which intersect the exposed area.
+	virtual void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = 0);
+	/// @return The number of parts.
+	int parts() const;
+	/// @return True if the parts are polygons, false for linestrings.
+	bool polygons() const;
+	/// @return The pen.
+	const QPen& pen() const;
+	/// @return The polygon fill.
+	const QBrush& brush() const;
+	/// Clip large parts to the exposed area before drawing them. The default is on.
+	/// @param on True to clip.
+	void setClipping(bool on);
+	/// @return True if large parts are clipped.
+	bool clipping() const;
+	/// Set the decimation tolerance. The default is 0.5 pixels.
+	/// @param pixels The distance, in device pixels, within which vertices
+	/// are dropped. Zero to draw every vertex.
+	void setDecimation(double pixels);
+	/// @return The decimation tolerance, in device pixels.
+	double decimation() const;
+	/// Map the vertices to device pixels with a PointTransform, when the pen
+	/// and brush allow it, rather than leave it to QPainter. The default is on.
+	/// @param on True to map the vertices here.
+	void setDeviceTransform(bool on);
+	/// @return True if the vertices may be mapped with a PointTransform.
+	bool deviceTransform() const;
+	/// @return The memory taken by the decimated and clipped geometry, and
+	/// the device pixel buffer, which are made as the item is painted, in bytes.
+	qint64 derivedBytes() const;
+	/// @return The memory taken by the decimation working space, which is
+	/// shared by all items, in bytes.
+	static qint64 scratchBytes();
+	/// Copy the geometry, so that it can be drawn without the item.
+	/// @param vertices The vertices of all parts are returned here.
+	/// @param partStart The first vertex of each part, counted from the
+	/// start of vertices, plus one past the end, is returned here.
+	/// @param partBoxes The bounding box of each part is returned here.
+	void copyParts(QVector<QPointF>& vertices, QVector<quint32>& partStart,
+			QVector<double>& partBoxes) const;
+	/// Draw every part with the item's pen and brush, without culling, clipping
+	/// or decimation, e.g. to record them (see DisplayListItem).
+	/// @param painter The painter.
+	void drawAll(QPainter* painter) const;
+	/// Draw the parts which intersect an area, with the painter's pen and brush.
+	/// @param painter The painter.
+	/// @param rect The area, in item coordinates.
+	/// @param polygons True if the parts are polygons, false for linestrings.
+	/// @param vertices The vertices of all parts.
+	/// @param partStart The first vertex of each part, plus one past the end.
+	/// @param partBoxes The bounding box of each part: xmin, ymin, xmax, ymax.
+	/// @param parts The number of parts.
+	static void drawParts(QPainter* painter, const QRectF& rect, bool polygons,
+			const QPointF* vertices, const quint32* partStart,
+			const double* partBoxes, int parts);
+	/// Clip a polygon to a rectangle (Sutherland-Hodgman). The result may have
+	/// edges along the rectangle, which is why the window is larger than the
+	/// exposed area.
+	/// @param v The vertices.
+	/// @param n The number of vertices.
+	/// @param r The rectangle.
+	/// @param out The clipped vertices are appended here. It is also used as
+	/// working space beyond its original end.
+	/// @param scratch Working space.
+	static void clipPolygon(const QPointF* v, int n, const QRectF& r,
+			QVector<QPointF>& out, QVector<QPointF>& scratch);
+	/// Clip a linestring to a rectangle (Liang-Barsky), which may split it.
+	/// @param v The vertices.
+	/// @param n The number of vertices.
+	/// @param r The rectangle.
+	/// @param out The vertices of the pieces are appended here.
+	/// @param starts The first vertex of each piece in out is appended here.
+	static void clipPolyline(const QPointF* v, int n, const QRectF& r,
+			QVector<QPointF>& out, QVector<quint32>& starts);
+
+protected:
+	/// Constructor for a subclass which supplies the geometry with setParts().
+	/// @param polygons True if the parts are polygons, false for linestrings.
+	/// @param pen The pen.
+	/// @param brush The polygon fill.
+	/// @param parent The parent item.
+	LayerItem(bool polygons, QPen pen, QBrush brush, QGraphicsItem* parent);
+	/// Point the item at its geometry, which it does not own.
+	/// @param vertices The vertices of all parts.
+	/// @param partStart The first vertex of each part, plus one past the end.
+	/// @param partBoxes The bounding box of each part: xmin, ymin, xmax, ymax.
+	/// @param parts The number of parts.
+	void setParts(const QPointF* vertices, const quint32* partStart,
+			const double* partBoxes, int parts);
+	/// Append a part to the owned arrays.
+	/// @param v The first vertex.
+	/// @param n The number of vertices.
+	void addPart(const QPointF* v, int n);
+	/// The geometry decimated for one zoom level.
+	class Decimated {
+	public:
+		/// The zoom level: the scale is at most 2^level device pixels per unit.
+		int _level;
+		/// The vertices. Empty unless _worthwhile.
+		QVector<QPointF> _vertices;
+		/// The first vertex of each part, plus one past the end. Empty unless _worthwhile.
+		QVector<quint32> _partStart;
+		/// The paint count when the level was last used, for recycling.
+		quint64 _used;
+		/// False if so few vertices were dropped that the original geometry is drawn.
+		bool _worthwhile;
+	};
+	/// @return The decimated geometry for a scale, making it if need be.
+	/// 0 if the tolerance is zero or hardly any vertices would be dropped.
+	/// @param scale The device pixels per item unit.
+	const Decimated* decimated(double scale);
+	/// Decimate the geometry for a zoom level.
+	/// @param level The zoom level.
+	/// @param out The vertices kept; room for all of them is needed.
+	/// @param start The first vertex of each part in out, plus one past the
+	/// end; room for _parts + 1 is needed.
+	/// @return The number of vertices kept.
+	int decimate(int level, QPointF* out, quint32* start) const;
+	/// Forget the decimated and clipped geometry.
+	void clearDerived();
+	/// Clip the large parts which cross the edge of a window.
+	/// @param window The clip window, in item coordinates.
+	/// @param vertices The vertices of all parts.
+	/// @param partStart The first vertex of each part, plus one past the end.
+	void clip(const QRectF& window, const QPointF* vertices, const quint32* partStart);
+	/// Draw the parts which intersect an area, substituting the clipped parts.
+	/// @param painter The painter.
+	/// @param rect The area, in item coordinates.
+	/// @param vertices The vertices of all parts.
+	/// @param partStart The first vertex of each part, plus one past the end.
+	void drawClipped(QPainter* painter, const QRectF& rect,
+			const QPointF* vertices, const quint32* partStart);
+	/// Map every part to device pixels in one pass, and draw the ones which
+	/// intersect an area.
+	/// @param painter The painter, with a translation only transform.
+	/// @param rect The area, in item coordinates.
+	/// @param vertices The vertices of all parts.
+	/// @param partStart The first vertex of each part, plus one past the end.
+	void drawDevice(QPainter* painter, const QRectF& rect,
+			const QPointF* vertices, const quint32* partStart);
+	/// Draw one part, mapping it to device pixels first if _deviceActive.
+	/// @param painter The painter.
+	/// @param v The vertices.
+	/// @param count The number of vertices.
+	void drawPart(QPainter* painter, const QPointF* v, int count);
+	/// Clip a part to _clipWindow, and draw the pieces with drawPart(). For
+	/// parts which are too small to have been clipped by clip(), but too
+	/// big for the device coordinates.
+	/// @param painter The painter.
+	/// @param v The vertices.
+	/// @param count The number of vertices.
+	void drawCut(QPainter* painter, const QPointF* v, int count);
+	/// Clip a linestring to a rectangle (Liang-Barsky), which may split it.
+	/// @param v The vertices.
+	/// @param n The number of vertices.
+	/// @param r The rectangle.
+	/// @param part The part number, appended to _clipPart for each piece.
+	void clipPolyline(const QPointF* v, int n, const QRectF& r, int part);
+	/// True if the parts are polygons.
+	bool _polygons;
+	/// The pen.
+	QPen _pen;
+	/// The polygon fill.
+	QBrush _brush;
+	/// The vertices of all parts.
+	const QPointF* _vertices;
+	/// The first vertex of each part, plus one past the end.
+	const quint32* _partStart;
+	/// The bounding box of each part.
+	const double* _partBoxes;
+	/// The number of parts.
+	int _parts;
+	/// The union of the part bounding boxes.
+	QRectF _bounds;
+	/// The vertices, when the item owns them.
+	QVector<QPointF> _ownVertices;
+	/// The part starts, when the item owns them.
+	QVector<quint32> _ownPartStart;
+	/// The part boxes, when the item owns them.
+	QVector<double> _ownPartBoxes;
+	/// True if large parts are clipped.
+	bool _clipping;
+	/// The window of the clipped parts, in item coordinates. Null when there are none.
+	QRectF _clipWindow;
+	/// The scale at which the clipped parts were made.
+	double _clipScale;
+	/// The vertices of the clipped parts.
+	QVector<QPointF> _clipVertices;
+	/// The part that each clipped piece came from, in increasing order. A
+	/// part may have several pieces, or one empty piece if nothing was left.
+	QVector<int> _clipPart;
+	/// The first vertex of each clipped piece, plus one past the end.
+	QVector<quint32> _clipStart;
+	/// Working space for clipPolygon().
+	QVector<QPointF> _clipScratch;
+	/// The decimation tolerance, in device pixels.
+	double _decimation;
+	/// The decimated geometry of recent zoom levels.
+	Decimated _decimated[DECIMATED_LEVELS];
+	/// Counts paints, to find the least recently used decimated level.
+	quint64 _paintCount;
+	/// True if the vertices may be mapped with a PointTransform.
+	bool _deviceTransform;
+	/// True while paint() is drawing in device pixels.
+	bool _deviceActive;
+	/// The painter's device transform, while _deviceActive.
+	PointTransform _device;
+	/// The mapped vertices. It only grows, so that it is not reallocated every paint.
+	QVector<QPoint> _devicePoints;
+};
+
+#endif /* LAYERITEM_H_ */
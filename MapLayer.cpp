@@ -0,0 +1,40 @@
+/*
+ * MapLayer.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "MapLayer.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapLayer::MapLayer(int index, qint64 page):
+	_index(index),
+	_page(page) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapLayer::~MapLayer() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+qint64 MapLayer::bytes() const {
+
+	qint64 bytes = _points.size() * sizeof(QPointF);
+
+	for (int i = 0; i < _labels.size(); i++) {
+		bytes += _labels[i].size() * sizeof(QChar);
+	}
+
+	for (int i = 0; i < _polygons.size(); i++) {
+		bytes += _polygons[i].size() * sizeof(QPointF);
+	}
+
+	for (int i = 0; i < _paths.size(); i++) {
+		bytes += _paths[i].elementCount() * sizeof(QPainterPath::Element);
+	}
+
+	for (int i = 0; i < _outlines.size(); i++) {
+		bytes += _outlines[i].elementCount() * sizeof(QPainterPath::Element);
+	}
+
+	return bytes;
+}
@@ -0,0 +1,61 @@
+/*
+ * MapLayer.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef MAPLAYER_H_
+#define MAPLAYER_H_
+
+#include <QtCore/QVector>
+#include <QtCore/QStringList>
+#include <QtCore/QPointF>
+#include <QtGui/QPolygonF>
+#include <QtGui/QPainterPath>
+#include <QtCore/QtGlobal>
+#include <string>
+
+/////////////////////////////////////////////////////////////////////
+/// @brief The geometry of one Feature, extracted from the database
+/// and converted to Qt graphics primitives.
+///
+/// A MapLayer holds nothing but value types, so it can be built
+/// in a worker thread and then handed over to the GUI thread, where
+/// QMicroMap turns it into QGraphicsItems.
+class MapLayer {
+public:
+	/// Constructor
+	/// @param index The position of the feature in QMicroMap::_features.
+	/// @param page The page that the layer covers; -1 for the whole map.
+	MapLayer(int index = -1, qint64 page = -1);
+	/// Destructor
+	virtual ~MapLayer();
+	/// @return An estimate of the memory taken by the geometry, in bytes.
+	/// The graphics items built from the layer hold copies of the same
+	/// vertices, so this is also an estimate of their size.
+	qint64 bytes() const;
+	/// The position of the feature in QMicroMap::_features.
+	int _index;
+	/// The page that the layer covers, when the map is paged. -1 for the whole map.
+	qint64 _page;
+	/// The table that the geometry was read from.
+	std::string _table;
+	/// The geometry column that was read.
+	std::string _geometryColumn;
+	/// The column that the labels were read from. Blank if none.
+	std::string _nameColumn;
+	/// Point locations.
+	QVector<QPointF> _points;
+	/// The label for each point in _points. Blank if none.
+	QStringList _labels;
+	/// The exterior rings of the polygons. For a page, they are clipped to
+	/// the page and drawn without an edge.
+	QVector<QPolygonF> _polygons;
+	/// The linestrings, as open paths.
+	QVector<QPainterPath> _paths;
+	/// For a page, the edges of the polygons, clipped to the page. They are
+	/// kept apart from _polygons so that the page boundary is not outlined.
+	QVector<QPainterPath> _outlines;
+};
+
+#endif /* MAPLAYER_H_ */
@@ -0,0 +1,137 @@
+/*
+ * MapLayerCache.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "MapLayerCache.h"
+#include "QMicroMap.h"
+#include "QMicroMapLoader.h"
+#include <math.h>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool MapLayerCache::Key::operator<(const Key& other) const {
+	if (_table != other._table) return _table < other._table;
+	if (_geometryColumn != other._geometryColumn) return _geometryColumn < other._geometryColumn;
+	if (_nameColumn != other._nameColumn) return _nameColumn < other._nameColumn;
+	if (_x0 != other._x0) return _x0 < other._x0;
+	if (_y0 != other._y0) return _y0 < other._y0;
+	if (_x1 != other._x1) return _x1 < other._x1;
+	return _y1 < other._y1;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapLayerCache::MapLayerCache(double x0, double y0, double xcell, double ycell, qint64 budget):
+	_x0(x0),
+	_y0(y0),
+	_xcell(xcell),
+	_ycell(ycell),
+	_budget(budget),
+	_bytes(0),
+	_hits(0),
+	_misses(0) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapLayerCache::~MapLayerCache() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapLayerCache::Key MapLayerCache::key(const LayerRequest& request) const {
+
+	Key k;
+	k._table = request._table;
+	k._geometryColumn = request._feature->_geometryName;
+	k._nameColumn = request._feature->_nameColumn;
+	k._x0 = llround((request._xmin - _x0) / _xcell);
+	k._y0 = llround((request._ymin - _y0) / _ycell);
+	k._x1 = llround((request._xmax - _x0) / _xcell);
+	k._y1 = llround((request._ymax - _y0) / _ycell);
+	return k;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool MapLayerCache::find(const LayerRequest& request, MapLayer& layer) {
+
+	std::map<Key, Entry>::iterator e = _entries.find(key(request));
+	if (e == _entries.end()) {
+		_misses++;
+		return false;
+	}
+	_hits++;
+
+	// move to the front of the queue
+	_lru.splice(_lru.begin(), _lru, e->second._lru);
+
+	layer = e->second._layer;
+	layer._index = request._index;
+	layer._page = request._page;
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void MapLayerCache::insert(const LayerRequest& request, const MapLayer& layer) {
+
+	if (_budget <= 0) {
+		return;
+	}
+
+	Key k = key(request);
+	std::map<Key, Entry>::iterator e = _entries.find(k);
+	if (e != _entries.end()) {
+		_bytes -= e->second._bytes;
+		_lru.erase(e->second._lru);
+		_entries.erase(e);
+	}
+
+	Entry& entry = _entries[k];
+	entry._layer = layer;
+	entry._bytes = layer.bytes() + sizeof(Entry);
+	entry._lru = _lru.insert(_lru.begin(), k);
+	_bytes += entry._bytes;
+
+	trim();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void MapLayerCache::trim() {
+
+	while (_bytes > _budget && !_lru.empty()) {
+		std::map<Key, Entry>::iterator e = _entries.find(_lru.back());
+		_bytes -= e->second._bytes;
+		_entries.erase(e);
+		_lru.pop_back();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void MapLayerCache::setBudget(qint64 budget) {
+	_budget = budget;
+	trim();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void MapLayerCache::clear() {
+	_entries.clear();
+	_lru.clear();
+	_bytes = 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+long MapLayerCache::hits() const {
+	return _hits;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+long MapLayerCache::misses() const {
+	return _misses;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+qint64 MapLayerCache::bytes() const {
+	return _bytes;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int MapLayerCache::size() const {
+	return _entries.size();
+}
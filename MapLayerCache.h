@@ -0,0 +1,106 @@
+/*
+ * MapLayerCache.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef MAPLAYERCACHE_H_
+#define MAPLAYERCACHE_H_
+
+#include <QtCore/QtGlobal>
+#include <map>
+#include <list>
+#include <string>
+#include "MapLayer.h"
+
+class LayerRequest;
+
+/////////////////////////////////////////////////////////////////////
+/// @brief A least recently used cache of decoded query results.
+///
+/// Results are keyed by the table, the geometry and name columns, and the
+/// bounding box of the query snapped to a grid of cells, so that the same
+/// area requested twice is recognised in spite of rounding. A result is
+/// held as the MapLayer that was built from it; the Qt containers in a
+/// MapLayer are implicitly shared, so storing and retrieving one copies no
+/// vertices. When the estimated size of the results exceeds the budget, the
+/// least recently used ones are dropped.
+///
+/// The cache is not thread safe; QMicroMap uses it from the GUI thread only.
+class MapLayerCache {
+public:
+	/// Constructor
+	/// @param x0 The longitude of the grid origin.
+	/// @param y0 The latitude of the grid origin.
+	/// @param xcell The width of a grid cell, in degrees.
+	/// @param ycell The height of a grid cell, in degrees.
+	/// @param budget The memory allowed for cached results, in bytes.
+	MapLayerCache(double x0, double y0, double xcell, double ycell, qint64 budget);
+	/// Destructor
+	virtual ~MapLayerCache();
+	/// Look up the result of a request.
+	/// @param request The request.
+	/// @param layer The cached result is copied here, with the index and
+	/// page of the request.
+	/// @return True if the result was cached.
+	bool find(const LayerRequest& request, MapLayer& layer);
+	/// Save the result of a request, dropping older results if needed.
+	/// @param request The request.
+	/// @param layer The result.
+	void insert(const LayerRequest& request, const MapLayer& layer);
+	/// Change the budget, dropping results if needed.
+	/// @param budget The memory allowed for cached results, in bytes.
+	/// Zero disables the cache.
+	void setBudget(qint64 budget);
+	/// Drop all results. The counters are not reset.
+	void clear();
+	/// @return The number of find() calls which found a result.
+	long hits() const;
+	/// @return The number of find() calls which did not.
+	long misses() const;
+	/// @return The estimated memory used by the cached results, in bytes.
+	qint64 bytes() const;
+	/// @return The number of cached results.
+	int size() const;
+
+protected:
+	/// The identity of a query.
+	class Key {
+	public:
+		std::string _table;
+		std::string _geometryColumn;
+		std::string _nameColumn;
+		/// The bounding box in grid cells.
+		qint64 _x0, _y0, _x1, _y1;
+		bool operator<(const Key& other) const;
+	};
+	/// A cached result.
+	class Entry {
+	public:
+		MapLayer _layer;
+		qint64 _bytes;
+		/// The position of the key in _lru.
+		std::list<Key>::iterator _lru;
+	};
+	/// @return The key for a request.
+	/// @param request The request.
+	Key key(const LayerRequest& request) const;
+	/// Drop the least recently used results until the budget is met.
+	void trim();
+	/// The grid origin and cell size.
+	double _x0, _y0, _xcell, _ycell;
+	/// The memory allowed for cached results.
+	qint64 _budget;
+	/// The estimated memory used by the cached results.
+	qint64 _bytes;
+	/// The results.
+	std::map<Key, Entry> _entries;
+	/// The keys, most recently used first.
+	std::list<Key> _lru;
+	/// Lookups which found a result.
+	long _hits;
+	/// Lookups which did not.
+	long _misses;
+};
+
+#endif /* MAPLAYERCACHE_H_ */
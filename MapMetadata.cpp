@@ -0,0 +1,330 @@
+/*
+ * MapMetadata.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "MapMetadata.h"
+#include "SpatiaLiteConnection.h"
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDateTime>
+#include <QtCore/QSaveFile>
+#include <QtCore/QTextStream>
+#include <QtCore/QStringList>
+#include <QtCore/QCryptographicHash>
+#include <stdlib.h>
+
+/// The first line of a sidecar file. Change the number when the layout changes.
+static const char* SIDECAR_VERSION = "qmicromap-metadata 3";
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+TableMetadata::TableMetadata():
+	_features(0),
+	_vertices(0),
+	_spatialIndex(0),
+	_fullScan(false),
+	_xmin(0.0),
+	_ymin(0.0),
+	_xmax(0.0),
+	_ymax(0.0) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+TableMetadata::~TableMetadata() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool TableMetadata::intersects(double xmin, double ymin, double xmax, double ymax) const {
+	if (_features == 0) {
+		return false;
+	}
+	return _xmin <= xmax && _xmax >= xmin && _ymin <= ymax && _ymax >= ymin;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapMetadata::MapMetadata():
+	_size(0),
+	_mtime(0),
+	_hashedSize(-1),
+	_hashedMtime(-1) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapMetadata::~MapMetadata() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string MapMetadata::sidecarPath(const std::string& dbPath) {
+	return dbPath + ".qmm";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool MapMetadata::stat(const std::string& dbPath) {
+
+	QFileInfo info(QString::fromStdString(dbPath));
+	if (!info.exists()) {
+		return false;
+	}
+	_dbPath = info.absoluteFilePath().toStdString();
+	_size = info.size();
+	_mtime = info.lastModified().toMSecsSinceEpoch();
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool MapMetadata::read(const std::string& dbPath) {
+
+	_tables.clear();
+	_lods.clear();
+	_contentHash.clear();
+	_hashedSize = -1;
+	_hashedMtime = -1;
+
+	if (!stat(dbPath)) {
+		return false;
+	}
+
+	QFile file(QString::fromStdString(sidecarPath(dbPath)));
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+		return false;
+	}
+	QTextStream in(&file);
+	in.setCodec("UTF-8");
+
+	if (in.readLine() != SIDECAR_VERSION) {
+		return false;
+	}
+
+	// the database identity
+	QStringList key = in.readLine().split('\t');
+	if (key.size() != 3 ||
+			key[0].toStdString() != _dbPath ||
+			key[1].toLongLong() != _size ||
+			key[2].toLongLong() != _mtime) {
+		return false;
+	}
+
+	while (!in.atEnd()) {
+		QStringList f = in.readLine().split('\t');
+		if (f.size() == 12 && f[0] == "table") {
+			TableMetadata t;
+			t._table          = f[1].toStdString();
+			t._geometryColumn = f[2].toStdString();
+			t._geometryType   = f[3].toStdString();
+			t._features       = f[4].toLong();
+			t._vertices       = f[5].toLong();
+			t._spatialIndex   = f[6].toInt();
+			t._fullScan       = f[7].toInt() != 0;
+			t._xmin           = f[8].toDouble();
+			t._ymin           = f[9].toDouble();
+			t._xmax           = f[10].toDouble();
+			t._ymax           = f[11].toDouble();
+			_tables[t._table] = t;
+		} else if (f.size() == 4 && f[0] == "lod") {
+			Lod lod;
+			lod._table     = f[1].toStdString();
+			lod._tolerance = f[2].toDouble();
+			lod._lodTable  = f[3].toStdString();
+			_lods.push_back(lod);
+		} else if (f.size() == 2 && f[0] == "hash" && f[1].size()) {
+			_contentHash = f[1].toStdString();
+			_hashedSize = _size;
+			_hashedMtime = _mtime;
+		} else if (f.size() > 1 || f[0].size()) {
+			// not something we wrote
+			_tables.clear();
+			_lods.clear();
+			_contentHash.clear();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void MapMetadata::scan(const std::string& dbPath, SpatiaLiteConnection& db) {
+
+	_tables.clear();
+	_lods.clear();
+	stat(dbPath);
+
+	std::vector<SpatiaLiteConnection::Row> geoTables = db.query(
+			"SELECT f_table_name, f_geometry_column FROM geometry_columns");
+
+	for (unsigned int i = 0; i < geoTables.size(); i++) {
+
+		TableMetadata t;
+		t._table = geoTables[i][0];
+		t._geometryColumn = geoTables[i][1];
+		// geometry_columns can claim an index that has been dropped
+		t._spatialIndex = db.spatialIndex(t._table, t._geometryColumn);
+
+		std::string g = "\"" + t._geometryColumn + "\"";
+		std::string from = " FROM \"" + t._table + "\"";
+
+		std::vector<SpatiaLiteConnection::Row> stats = db.query(
+				"SELECT Count(" + g + "), Sum(ST_NPoints(" + g + ")), "
+				"Min(MbrMinX(" + g + ")), Min(MbrMinY(" + g + ")), "
+				"Max(MbrMaxX(" + g + ")), Max(MbrMaxY(" + g + "))" + from);
+		if (stats.size()) {
+			t._features = atol(stats[0][0].c_str());
+			t._vertices = atol(stats[0][1].c_str());
+			t._xmin = atof(stats[0][2].c_str());
+			t._ymin = atof(stats[0][3].c_str());
+			t._xmax = atof(stats[0][4].c_str());
+			t._ymax = atof(stats[0][5].c_str());
+		}
+
+		std::vector<SpatiaLiteConnection::Row> type = db.query(
+				"SELECT GeometryType(" + g + ")" + from + " WHERE " + g + " IS NOT NULL LIMIT 1");
+		if (type.size()) {
+			t._geometryType = type[0][0];
+		}
+
+		_tables[t._table] = t;
+	}
+
+	// most databases will not have been through mapcompile
+	if (db.query("SELECT name FROM sqlite_master WHERE type = 'table' AND name = 'qmicromap_lod'").size()) {
+		std::vector<SpatiaLiteConnection::Row> rows =
+				db.query("SELECT table_name, tolerance, lod_table FROM qmicromap_lod");
+		for (unsigned int i = 0; i < rows.size(); i++) {
+			Lod lod;
+			lod._table = rows[i][0];
+			lod._tolerance = atof(rows[i][1].c_str());
+			lod._lodTable = rows[i][2];
+			_lods.push_back(lod);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void MapMetadata::setSpatialIndex(const std::string& table, int spatialIndex) {
+
+	std::map<std::string, TableMetadata>::iterator i = _tables.find(table);
+	if (i != _tables.end()) {
+		i->second._spatialIndex = spatialIndex;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void MapMetadata::setFullScan(const std::string& table, bool fullScan) {
+
+	std::map<std::string, TableMetadata>::iterator i = _tables.find(table);
+	if (i != _tables.end()) {
+		i->second._fullScan = fullScan;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool MapMetadata::write() {
+
+	// Match the database as it is now, which includes any changes that
+	// were recorded with setSpatialIndex() and setFullScan().
+	if (_dbPath.empty() || !stat(_dbPath)) {
+		return false;
+	}
+
+	// QSaveFile writes to a temporary file, and renames it on commit(),
+	// so a reader never sees a partial file.
+	QSaveFile file(QString::fromStdString(sidecarPath(_dbPath)));
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+		return false;
+	}
+	QTextStream out(&file);
+	out.setCodec("UTF-8");
+	out.setRealNumberPrecision(17);
+
+	out << SIDECAR_VERSION << "\n";
+	out << QString::fromStdString(_dbPath) << "\t" << _size << "\t" << _mtime << "\n";
+	// only if contentHash() has been asked for since the database changed
+	if (_hashedSize == _size && _hashedMtime == _mtime && !_contentHash.empty()) {
+		out << "hash\t" << QString::fromStdString(_contentHash) << "\n";
+	}
+
+	for (std::map<std::string, TableMetadata>::iterator i = _tables.begin(); i != _tables.end(); i++) {
+		TableMetadata& t = i->second;
+		out << "table\t"
+			<< QString::fromStdString(t._table) << "\t"
+			<< QString::fromStdString(t._geometryColumn) << "\t"
+			<< QString::fromStdString(t._geometryType) << "\t"
+			<< (qint64)t._features << "\t"
+			<< (qint64)t._vertices << "\t"
+			<< t._spatialIndex << "\t"
+			<< (t._fullScan ? 1 : 0) << "\t"
+			<< t._xmin << "\t" << t._ymin << "\t" << t._xmax << "\t" << t._ymax << "\n";
+	}
+
+	for (unsigned int i = 0; i < _lods.size(); i++) {
+		out << "lod\t"
+			<< QString::fromStdString(_lods[i]._table) << "\t"
+			<< _lods[i]._tolerance << "\t"
+			<< QString::fromStdString(_lods[i]._lodTable) << "\n";
+	}
+
+	out.flush();
+	return file.commit();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::vector<std::string> MapMetadata::tables() const {
+
+	std::vector<std::string> names;
+	for (std::map<std::string, TableMetadata>::const_iterator i = _tables.begin(); i != _tables.end(); i++) {
+		names.push_back(i->first);
+	}
+	return names;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+const TableMetadata* MapMetadata::table(const std::string& table) const {
+
+	std::map<std::string, TableMetadata>::const_iterator i = _tables.find(table);
+	if (i == _tables.end()) {
+		return 0;
+	}
+	return &i->second;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+const std::vector<MapMetadata::Lod>& MapMetadata::lods() const {
+	return _lods;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+const std::string& MapMetadata::contentHash() {
+
+	if (_dbPath.empty()) {
+		return _contentHash;
+	}
+	if (_hashedSize != _size || _hashedMtime != _mtime) {
+		hashContent();
+		// so that the next run does not read the whole file again
+		write();
+	}
+	return _contentHash;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void MapMetadata::hashContent() {
+
+	_contentHash.clear();
+	_hashedSize = _size;
+	_hashedMtime = _mtime;
+
+	QFile file(QString::fromStdString(_dbPath));
+	if (!file.open(QIODevice::ReadOnly)) {
+		return;
+	}
+
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	while (!file.atEnd()) {
+		QByteArray block = file.read(1024 * 1024);
+		if (block.isEmpty()) {
+			return;
+		}
+		hash.addData(block);
+	}
+	_contentHash = hash.result().toHex().constData();
+}
@@ -0,0 +1,153 @@
+/*
+ * MapMetadata.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef MAPMETADATA_H_
+#define MAPMETADATA_H_
+
+#include <QtCore/QtGlobal>
+#include <vector>
+#include <map>
+#include <string>
+
+class SpatiaLiteConnection;
+
+/////////////////////////////////////////////////////////////////////
+/// @brief What QMicroMap needs to know about one geometry table.
+class TableMetadata {
+public:
+	/// Constructor
+	TableMetadata();
+	/// Destructor
+	virtual ~TableMetadata();
+	/// @return True if the table has geometry within a bounding box.
+	/// @param xmin The bounding box minimum longitude, in decimal degrees.
+	/// @param ymin The bounding box minimum latitude, in decimal degrees.
+	/// @param xmax The bounding box maximum longitude, in decimal degrees.
+	/// @param ymax The bounding box maximum latitude, in decimal degrees.
+	bool intersects(double xmin, double ymin, double xmax, double ymax) const;
+	/// The table name.
+	std::string _table;
+	/// The geometry column.
+	std::string _geometryColumn;
+	/// The geometry type of the first row, e.g. MULTIPOLYGON.
+	std::string _geometryType;
+	/// The number of rows with geometry.
+	long _features;
+	/// The total number of vertices.
+	long _vertices;
+	/// The spatial index, as in geometry_columns.spatial_index_enabled:
+	/// 0 for none, 1 for an R*Tree, 2 for an MBR cache.
+	int _spatialIndex;
+	/// True if QMicroMap's geometry query reads the whole table, which it
+	/// works out from the query plan when the database has been scanned.
+	bool _fullScan;
+	/// The extent of the geometry.
+	double _xmin;
+	/// The extent of the geometry.
+	double _ymin;
+	/// The extent of the geometry.
+	double _xmax;
+	/// The extent of the geometry.
+	double _ymax;
+};
+
+/////////////////////////////////////////////////////////////////////
+/// @brief A summary of the geometry tables in a database, kept in a
+/// sidecar file next to it.
+///
+/// Collecting the extent and vertex count of every table means reading
+/// all of the geometry, so the results are saved in <database>.qmm. The
+/// file records the path, size and modification time of the database; if
+/// any of them differ, the file is ignored, and rewritten after the
+/// database has been scanned again. The level of detail tables listed in
+/// qmicromap_lod are saved as well, so that a map can be set up without
+/// querying the database at all. A SHA-1 hash of the database file, which
+/// identifies its content wherever the file is, for instance to key a
+/// TileStore, is saved too once contentHash() has been asked for. Reading
+/// a large database takes a while, so it is not done otherwise.
+///
+/// The sidecar is a tab separated text file, starting with a version line.
+/// If it cannot be written, for instance because the directory is read only,
+/// the database is scanned on every run.
+class MapMetadata {
+public:
+	/// One row of qmicromap_lod.
+	class Lod {
+	public:
+		/// The full resolution table.
+		std::string _table;
+		/// The simplification tolerance, in degrees.
+		double _tolerance;
+		/// The simplified table.
+		std::string _lodTable;
+	};
+	/// Constructor
+	MapMetadata();
+	/// Destructor
+	virtual ~MapMetadata();
+	/// Read the sidecar of a database.
+	/// @param dbPath Path to the database.
+	/// @return True if the sidecar exists and matches the database.
+	bool read(const std::string& dbPath);
+	/// Collect the metadata from the database itself.
+	/// @param dbPath Path to the database.
+	/// @param db A connection to the database.
+	/// @throws std::runtime_error on a database error.
+	void scan(const std::string& dbPath, SpatiaLiteConnection& db);
+	/// Record a change of spatial index, made by this program.
+	/// @param table The table name.
+	/// @param spatialIndex The new index kind.
+	void setSpatialIndex(const std::string& table, int spatialIndex);
+	/// Record whether the geometry query of a table reads the whole table.
+	/// @param table The table name.
+	/// @param fullScan True if it does.
+	void setFullScan(const std::string& table, bool fullScan);
+	/// Save the metadata in the sidecar, keyed by the current size and
+	/// modification time of the database. This includes the changes recorded
+	/// by setSpatialIndex() and setFullScan().
+	/// @return False if the file could not be written.
+	bool write();
+	/// @return The names of the geometry tables.
+	std::vector<std::string> tables() const;
+	/// @return The metadata of a table, or 0 if it is not a geometry table.
+	/// @param table The table name.
+	const TableMetadata* table(const std::string& table) const;
+	/// @return The level of detail tables.
+	const std::vector<Lod>& lods() const;
+	/// @return The SHA-1 hash of the database file, in hex. Blank if it
+	/// could not be read. It is computed on the first call after the database
+	/// changes, which reads the whole file, and then saved in the sidecar.
+	const std::string& contentHash();
+	/// @return The sidecar path for a database.
+	/// @param dbPath Path to the database.
+	static std::string sidecarPath(const std::string& dbPath);
+
+protected:
+	/// Record the size and modification time of the database.
+	/// @param dbPath Path to the database.
+	/// @return False if the database file cannot be found.
+	bool stat(const std::string& dbPath);
+	/// Hash the contents of the database file into _contentHash.
+	void hashContent();
+	/// The absolute path of the database.
+	std::string _dbPath;
+	/// The size of the database file.
+	qint64 _size;
+	/// The modification time of the database file, in ms since the epoch.
+	qint64 _mtime;
+	/// The geometry tables, by name.
+	std::map<std::string, TableMetadata> _tables;
+	/// The level of detail tables.
+	std::vector<Lod> _lods;
+	/// The SHA-1 hash of the database file, in hex.
+	std::string _contentHash;
+	/// The value of _size when _contentHash was computed.
+	qint64 _hashedSize;
+	/// The value of _mtime when _contentHash was computed.
+	qint64 _hashedMtime;
+};
+
+#endif /* MAPMETADATA_H_ */
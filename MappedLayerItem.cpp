@@ -0,0 +1,24 @@
+/*
+ * MappedLayerItem.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "MappedLayerItem.h"
+#include "GeometryCache.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MappedLayerItem::MappedLayerItem(const MappedLayer* layer, bool polygons, QPen pen, QBrush brush,
+		QGraphicsItem* parent):
+	LayerItem(polygons, pen, brush, parent) {
+
+	// the polygons are the first parts, followed by the linestrings
+	int first = polygons ? 0 : layer->_polygons;
+	int parts = polygons ? layer->_polygons : layer->_paths;
+
+	setParts(layer->_vertices, layer->_partStart + first,
+			layer->_partBoxes + 4*first, parts);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MappedLayerItem::~MappedLayerItem() {
+}
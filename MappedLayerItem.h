@@ -0,0 +1,34 @@
+/*
+ * MappedLayerItem.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef MAPPEDLAYERITEM_H_
+#define MAPPEDLAYERITEM_H_
+
+#include "LayerItem.h"
+
+class MappedLayer;
+
+/////////////////////////////////////////////////////////////////////
+/// @brief Draw the polygons or the linestrings of a MappedLayer,
+/// straight from the memory mapped GeometryCache.
+///
+/// The vertices are handed to QPainter where they lie in the mapping;
+/// the item keeps no copy of them. The GeometryCache must outlive the item.
+class MappedLayerItem: public LayerItem {
+public:
+	/// Constructor
+	/// @param layer The layer.
+	/// @param polygons True to draw the polygons, false for the linestrings.
+	/// @param pen The pen.
+	/// @param brush The polygon fill.
+	/// @param parent The parent item.
+	MappedLayerItem(const MappedLayer* layer, bool polygons, QPen pen, QBrush brush,
+			QGraphicsItem* parent = 0);
+	/// Destructor
+	virtual ~MappedLayerItem();
+};
+
+#endif /* MAPPEDLAYERITEM_H_ */
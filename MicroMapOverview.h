@@ -77,6 +77,14 @@
 /// The desired shape files are selected from the Natural Earth datasets, and used to build
 /// the desired SpatiaLite database.
 ///
+/// A database built at one scale can be paired with a more detailed one. The 1:50m
+/// database is small, and quick to draw at world and continental scale; the 1:10m
+/// database is only opened when the view is zoomed in past the given span
+/// (see QMicroMap::addDatabase()):
+/// @code
+/// qmmtest -d ne_50m.sqlite -f ne_10m.sqlite,30
+/// @endcode
+///
 /// @subsection MicroMapOSM Open Street Maps
 ///
 /// Open Street Maps (OSM) is another high quality public domain geographic database. OSM
@@ -94,6 +102,36 @@
 /// correctly. Some more investigation and code modification could most likely
 /// smooth these wrinkles out.
 ///
+/// An OSM extract is usually far larger than the memory of the machine displaying
+/// it. QMicroMap can be given a memory budget, in which case it pages in only the
+/// geometry around the current view (see QMicroMap).
+///
+/// @subsection MicroMapLOD Level of Detail Tables
+///
+/// At world scale the full resolution Natural Earth geometry puts many vertices on
+/// each screen pixel. The mapcompile utility (built in spatialtest) adds simplified
+/// copies of each line and polygon table to a database, named for example
+/// coastline__lod0 (coarsest) through coastline__lod4 (finest), each with an
+/// R*Tree spatial index. The copies are listed in the qmicromap_lod table.
+/// QMicroMap reads the coarsest copy that is accurate to within a pixel at the
+/// current zoom level, and falls back to the original table when zoomed in further.
+/// @code
+/// cp ne_10m.sqlite ne_10m_lod.sqlite
+/// mapcompile -d ne_10m_lod.sqlite -l 5 -t 0.01
+/// @endcode
+///
+/// @subsection MicroMapGeometryCache Geometry Cache
+///
+/// Decoding the SpatiaLite blobs dominates the start up time for a large database.
+/// qmmtest -x writes the decoded layers into a flat binary file next to the database
+/// (ne_10m.sqlite.qmmgeo), which later maps memory map and draw from directly. The
+/// file is ignored once the database is modified. qmmtest -t reports the start up
+/// time and resident memory, with or without the file.
+/// @code
+/// qmmtest -d ne_10m.sqlite -x
+/// qmmtest -d ne_10m.sqlite -t
+/// @endcode
+///
 /// @section MicroMapNotes Introductory Notes About SQLite and SpatiaLite
 ///
 /// As described above, the two core components used in MicroMap are SQLite and
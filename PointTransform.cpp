@@ -0,0 +1,243 @@
+/*
+ * PointTransform.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "PointTransform.h"
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define POINT_TRANSFORM_X86 1
+#include <immintrin.h>
+#endif
+
+// The kernels treat QPointF as two packed doubles, and QPoint as two packed ints.
+typedef char QPointFIsPacked[sizeof(QPointF) == 2 * sizeof(double) ? 1 : -1];
+typedef char QPointIsPacked[sizeof(QPoint) == 2 * sizeof(int) ? 1 : -1];
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Map points one at a time.
+/// @param m The coefficients: m11, m12, m21, m22, dx, dy.
+/// @param src The x, y pairs.
+/// @param n The number of points.
+/// @param dst The mapped x, y pairs.
+static void mapScalar(const double* m, const double* src, int n, int* dst) {
+
+	const double limit = PointTransform::DEVICE_LIMIT;
+	for (int i = 0; i < n; i++) {
+		double x = src[2*i];
+		double y = src[2*i+1];
+		double dx = m[0] * x + m[2] * y + m[4];
+		double dy = m[1] * x + m[3] * y + m[5];
+		// comparisons that are false for NaN, as in the vector kernels' min and max
+		dx = dx < limit ? dx : limit;
+		dx = dx > -limit ? dx : -limit;
+		dy = dy < limit ? dy : limit;
+		dy = dy > -limit ? dy : -limit;
+		// round half to even, like cvtpd2dq
+		dst[2*i] = (int)rint(dx);
+		dst[2*i+1] = (int)rint(dy);
+	}
+}
+
+#ifdef POINT_TRANSFORM_X86
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Map points two at a time, a point to an SSE2 register.
+/// @param m The coefficients: m11, m12, m21, m22, dx, dy.
+/// @param src The x, y pairs.
+/// @param n The number of points.
+/// @param dst The mapped x, y pairs.
+__attribute__((target("sse2")))
+static void mapSSE2(const double* m, const double* src, int n, int* dst) {
+
+	// (x', y') = x (m11, m12) + y (m21, m22) + (dx, dy)
+	const __m128d a = _mm_set_pd(m[1], m[0]);
+	const __m128d b = _mm_set_pd(m[3], m[2]);
+	const __m128d c = _mm_set_pd(m[5], m[4]);
+	const __m128d hi = _mm_set1_pd(PointTransform::DEVICE_LIMIT);
+	const __m128d lo = _mm_set1_pd(-PointTransform::DEVICE_LIMIT);
+
+	int i = 0;
+	for (; i + 2 <= n; i += 2) {
+		__m128d p0 = _mm_loadu_pd(src + 2*i);
+		__m128d p1 = _mm_loadu_pd(src + 2*i + 2);
+		__m128d r0 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_unpacklo_pd(p0, p0), a),
+				_mm_mul_pd(_mm_unpackhi_pd(p0, p0), b)), c);
+		__m128d r1 = _mm_add_pd(_mm_add_pd(_mm_mul_pd(_mm_unpacklo_pd(p1, p1), a),
+				_mm_mul_pd(_mm_unpackhi_pd(p1, p1), b)), c);
+		r0 = _mm_max_pd(_mm_min_pd(r0, hi), lo);
+		r1 = _mm_max_pd(_mm_min_pd(r1, hi), lo);
+		__m128i q = _mm_unpacklo_epi64(_mm_cvtpd_epi32(r0), _mm_cvtpd_epi32(r1));
+		_mm_storeu_si128((__m128i*)(dst + 2*i), q);
+	}
+
+	mapScalar(m, src + 2*i, n - i, dst + 2*i);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Map points four at a time, two points to an AVX register.
+/// @param m The coefficients: m11, m12, m21, m22, dx, dy.
+/// @param src The x, y pairs.
+/// @param n The number of points.
+/// @param dst The mapped x, y pairs.
+__attribute__((target("avx2")))
+static void mapAVX2(const double* m, const double* src, int n, int* dst) {
+
+	const __m256d a = _mm256_set_pd(m[1], m[0], m[1], m[0]);
+	const __m256d b = _mm256_set_pd(m[3], m[2], m[3], m[2]);
+	const __m256d c = _mm256_set_pd(m[5], m[4], m[5], m[4]);
+	const __m256d hi = _mm256_set1_pd(PointTransform::DEVICE_LIMIT);
+	const __m256d lo = _mm256_set1_pd(-PointTransform::DEVICE_LIMIT);
+
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		__m256d p0 = _mm256_loadu_pd(src + 2*i);
+		__m256d p1 = _mm256_loadu_pd(src + 2*i + 4);
+		// unpack works within each 128 bit lane, i.e. within each point
+		__m256d r0 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_unpacklo_pd(p0, p0), a),
+				_mm256_mul_pd(_mm256_unpackhi_pd(p0, p0), b)), c);
+		__m256d r1 = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(_mm256_unpacklo_pd(p1, p1), a),
+				_mm256_mul_pd(_mm256_unpackhi_pd(p1, p1), b)), c);
+		r0 = _mm256_max_pd(_mm256_min_pd(r0, hi), lo);
+		r1 = _mm256_max_pd(_mm256_min_pd(r1, hi), lo);
+		_mm_storeu_si128((__m128i*)(dst + 2*i), _mm256_cvtpd_epi32(r0));
+		_mm_storeu_si128((__m128i*)(dst + 2*i + 4), _mm256_cvtpd_epi32(r1));
+	}
+
+	mapSSE2(m, src + 2*i, n - i, dst + 2*i);
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+PointTransform::PointTransform() {
+
+	_m[0] = 1.0;
+	_m[1] = 0.0;
+	_m[2] = 0.0;
+	_m[3] = 1.0;
+	_m[4] = 0.0;
+	_m[5] = 0.0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+PointTransform::PointTransform(const QTransform& transform) {
+
+	_m[0] = transform.m11();
+	_m[1] = transform.m12();
+	_m[2] = transform.m21();
+	_m[3] = transform.m22();
+	_m[4] = transform.dx();
+	_m[5] = transform.dy();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+PointTransform::~PointTransform() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void PointTransform::map(const QPointF* src, int n, QPoint* dst) const {
+
+	static const ISA best = bestISA();
+	map(src, n, dst, best);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void PointTransform::map(const QPointF* src, int n, QPoint* dst, ISA isa) const {
+
+	const double* s = (const double*)src;
+	int* d = (int*)dst;
+
+	switch (isa) {
+#ifdef POINT_TRANSFORM_X86
+	case ISA_AVX2:
+		mapAVX2(_m, s, n, d);
+		break;
+	case ISA_SSE2:
+		mapSSE2(_m, s, n, d);
+		break;
+#endif
+	default:
+		mapScalar(_m, s, n, d);
+		break;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool PointTransform::fits(const QRectF& r) const {
+
+	// the transform is affine, so the corners bound the rest
+	const double limit = DEVICE_LIMIT;
+	double x[2] = { r.left(), r.right() };
+	double y[2] = { r.top(), r.bottom() };
+	for (int i = 0; i < 2; i++) {
+		for (int j = 0; j < 2; j++) {
+			double dx = _m[0] * x[i] + _m[2] * y[j] + _m[4];
+			double dy = _m[1] * x[i] + _m[3] * y[j] + _m[5];
+			// false for NaN
+			if (!(fabs(dx) < limit && fabs(dy) < limit)) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int PointTransform::dropRepeats(QPoint* p, int n) {
+
+	if (n < 2) {
+		return n;
+	}
+
+	int kept = 1;
+	for (int i = 1; i < n; i++) {
+		if (p[i] != p[kept-1]) {
+			p[kept++] = p[i];
+		}
+	}
+	return kept;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool PointTransform::supported(ISA isa) {
+
+	switch (isa) {
+	case ISA_SCALAR:
+		return true;
+#ifdef POINT_TRANSFORM_X86
+	case ISA_SSE2:
+		return __builtin_cpu_supports("sse2");
+	case ISA_AVX2:
+		return __builtin_cpu_supports("avx2");
+#endif
+	default:
+		return false;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+PointTransform::ISA PointTransform::bestISA() {
+
+	if (supported(ISA_AVX2)) {
+		return ISA_AVX2;
+	}
+	if (supported(ISA_SSE2)) {
+		return ISA_SSE2;
+	}
+	return ISA_SCALAR;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+const char* PointTransform::name(ISA isa) {
+
+	switch (isa) {
+	case ISA_SSE2:
+		return "SSE2";
+	case ISA_AVX2:
+		return "AVX2";
+	default:
+		return "scalar";
+	}
+}
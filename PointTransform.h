@@ -0,0 +1,83 @@
+/*
+ * PointTransform.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef POINTTRANSFORM_H_
+#define POINTTRANSFORM_H_
+
+#include <QtCore/QPoint>
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+#include <QtGui/QTransform>
+
+/////////////////////////////////////////////////////////////////////
+/// @brief Map arrays of scene coordinates to integer device pixels,
+/// through an affine transform, several points at a time.
+///
+/// QPainter maps every vertex of a path through the world transform,
+/// one at a time. A LayerItem whose vertices are packed end to end can
+/// instead map them all in one pass, and hand QPainter integer device
+/// coordinates under a translation only transform.
+///
+/// There are SSE2 and AVX2 kernels, and a scalar one for other
+/// processors. The best one the processor supports is chosen at run
+/// time; map() can also be told which to use, for testing and
+/// benchmarking. All of them round to the nearest pixel, and clamp to
+/// +/- DEVICE_LIMIT, so they give identical results.
+class PointTransform {
+public:
+	/// The instruction set used by a kernel.
+	enum ISA {
+		ISA_SCALAR,
+		ISA_SSE2,
+		ISA_AVX2
+	};
+	/// Device coordinates are clamped to this magnitude, which leaves
+	/// room for QPainter's fixed point arithmetic.
+	static const int DEVICE_LIMIT = 1 << 24;
+	/// Constructor for the identity transform.
+	PointTransform();
+	/// Constructor
+	/// @param transform The transform. Only the affine part is used.
+	PointTransform(const QTransform& transform);
+	/// Destructor
+	virtual ~PointTransform();
+	/// Map points with the best kernel for this processor.
+	/// @param src The points.
+	/// @param n The number of points.
+	/// @param dst The mapped points are returned here. Room for n.
+	void map(const QPointF* src, int n, QPoint* dst) const;
+	/// Map points with a particular kernel.
+	/// @param src The points.
+	/// @param n The number of points.
+	/// @param dst The mapped points are returned here. Room for n.
+	/// @param isa The kernel. It must be supported().
+	void map(const QPointF* src, int n, QPoint* dst, ISA isa) const;
+	/// @return True if the whole of a rectangle maps inside +/- DEVICE_LIMIT,
+	/// so that no point in it would be clamped. Clamping x and y separately
+	/// would bend a line which runs outside the limit.
+	/// @param r The rectangle.
+	bool fits(const QRectF& r) const;
+	/// Remove consecutive duplicates, which are common once points have
+	/// been rounded to pixels.
+	/// @param p The points, which are compacted in place.
+	/// @param n The number of points.
+	/// @return The number of points left.
+	static int dropRepeats(QPoint* p, int n);
+	/// @return The best kernel for this processor.
+	static ISA bestISA();
+	/// @return True if this processor can run a kernel.
+	/// @param isa The kernel.
+	static bool supported(ISA isa);
+	/// @return The name of a kernel.
+	/// @param isa The kernel.
+	static const char* name(ISA isa);
+
+protected:
+	/// The transform coefficients: m11, m12, m21, m22, dx, dy.
+	double _m[6];
+};
+
+#endif /* POINTTRANSFORM_H_ */
@@ -5,15 +5,52 @@
  *      Author: martinc
  */
 #include "QMicroMap.h"
+#include "QMicroMapLoader.h"
+#include "MapLayer.h"
+#include "SpatiaLiteConnection.h"
+#include "LayerItem.h"
+#include "MappedLayerItem.h"
+#include "DisplayListItem.h"
+#include "GraticuleItem.h"
+#include "TilePyramidItem.h"
+#include "TileStore.h"
+#include <QtWidgets/QStyleOptionGraphicsItem>
+#include <QtWidgets/QApplication>
 #include <iostream>
+#include <stdlib.h>
 #include <algorithm>
 #include <assert.h>
+#include <math.h>
+#include <float.h>
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 void printTransform(QTransform t) {
 	std::cout << "m11:" << t.m11() << " m22:" << t.m22() << std::endl;
 }
 
+/// The z value given to the items of the first feature; each following feature is
+/// one higher. It keeps the features in _features order, and underneath the labels,
+/// the grid and anything added by the user, no matter what order the layers are drawn in.
+static const double FEATURE_Z = -1000.0;
+
+/// The deepest page grid level. There are 2^PAGE_LEVELS pages across the map.
+static const int PAGE_LEVELS = 20;
+
+/// The margin around the view that is also paged in, as a fraction of the view size.
+static const double PAGE_MARGIN = 0.25;
+
+/// The approximate memory taken by a graphics item, apart from its geometry.
+static const qint64 ITEM_BYTES = 200;
+
+/// The QGraphicsItem::data() key which marks the items of the map layers.
+static const int BASE_LAYER_KEY = 0x4d4d;
+
+/// The default memory allowed for cached query results.
+static const qint64 QUERY_CACHE_BYTES = 64 * 1024 * 1024;
+
+/// The default share of a paged map's memory budget allowed for cached query results.
+static const double QUERY_CACHE_SHARE = 0.25;
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 Feature::Feature(
 		std::string tableName,
@@ -23,13 +60,26 @@ Feature::Feature(
 	_tableName(tableName),
 	_baseColor(baseColor),
 	_geometryName(geometryName),
-	_nameColumn(nameColumn) {
+	_nameColumn(nameColumn),
+	_detail(false) {
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 Feature::~Feature() {
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string Feature::table(double resolution) const {
+
+	// The map is ordered by tolerance, so the last acceptable entry is the coarsest.
+	std::string table = _tableName;
+	for (std::map<double, std::string>::const_iterator lod = _lodTables.begin();
+			lod != _lodTables.end() && lod->first <= resolution; lod++) {
+		table = lod->second;
+	}
+	return table;
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 PointFeature::PointFeature(
 		std::string tableName,
@@ -71,31 +121,91 @@ PolygonFeature::PolygonFeature(
 PolygonFeature::~PolygonFeature() {
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapPage::MapPage():
+	_bytes(0),
+	_lastUsed(0) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapPage::~MapPage() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapDatabase::MapDatabase(std::string dbPath, double maxSpan):
+	_dbPath(dbPath),
+	_maxSpan(maxSpan) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapDatabase::~MapDatabase() {
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 QMicroMap::QMicroMap(SpatiaLiteDB& db, double xmin, double ymin, double xmax,
-		double ymax, std::string backgroundColor, QWidget* parent):
+		double ymax, std::string backgroundColor, QWidget* parent, LOAD_MODE loadMode,
+		qint64 memoryBudget):
 	QGraphicsView(parent),
 	_db(db),
+	_database(0),
+	_dbPath(db.dbPath()),
+	_connection(0),
 	_xmin(xmin),
 	_ymin(ymin),
 	_xmax(xmax),
 	_ymax(ymax),
 	_pointsGroup(0),
 	_gridOn(true),
-	_gridGroup(0),
-	_topRightLabel(0),
-	_topLeftLabel(0),
+	_graticule(0),
+	_annotationFont("helvetica", 12),
 	_mouseMode(MOUSE_ZOOM),
 	_rubberBand(0),
 	_rbOrigin(100,100),
-	_timerId(-1) {
+	_timerId(-1),
+	_loadMode(loadMode),
+	_loader(0),
+	_dbPool(0),
+	_nextLayer(0),
+	_loadTotal(0),
+	_loadReported(0),
+	_reportPosted(false),
+	_batchLayers(true),
+	_lodPixels(1.0),
+	_memoryBudget(memoryBudget),
+	_memoryUsed(0),
+	_pageLevel(0),
+	_pageClock(0),
+	// the cache grid is the finest page grid, so every page is a whole number of cells
+	_queryCache(xmin, ymin, (xmax - xmin) / (1 << PAGE_LEVELS),
+			(ymax - ymin) / (1 << PAGE_LEVELS),
+			memoryBudget > 0 ? (qint64)(memoryBudget * QUERY_CACHE_SHARE) : QUERY_CACHE_BYTES),
+	_tiles(0),
+	_tileStore(0),
+	_tileRasterizer(false),
+	_backgroundCache(true),
+	_decimationPixels(0.5),
+	_displayLists(false),
+	_interactiveQuality(true),
+	_interactiveHide(0),
+	_interacting(false),
+	_labelsShown(false),
+	_resizePending(false),
+	_zoomFrameBudget(0),
+	_resizePreview(false),
+	_capturing(false),
+	_dirty(0),
+	_updateDepth(0),
+	_redrawPosted(false) {
+
+	_databases.push_back(MapDatabase(_dbPath, DBL_MAX));
 
 	// determine what features we will use from this database
 	selectFeatures();
 
-	// Some say that antaliasing is a performance hit, and that it doesn't improver
-	// the rendering. Neither was verified by my testing.
+	// Antialiasing costs frame rate, so it is turned off while the map is
+	// being dragged (see setInteractiveQuality()), and back on when it stops.
 	setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
+	_fullHints = renderHints();
 
 	// Allows the mouse events to pan the display
 	setDragMode(QGraphicsView::NoDrag);
@@ -106,6 +216,9 @@ QMicroMap::QMicroMap(SpatiaLiteDB& db, double xmin, double ymin, double xmax,
 	_scene = new QGraphicsScene(this);
 	setScene(_scene);
 
+	// the map layers are painted with the background
+	setCacheMode(QGraphicsView::CacheBackground);
+
 	// set the background color
 	setBackgroundBrush(QBrush(backgroundColor.c_str()));
 
@@ -125,11 +238,11 @@ QMicroMap::QMicroMap(SpatiaLiteDB& db, double xmin, double ymin, double xmax,
 	_scene->addItem(_pointsGroup);
 	_pointsGroup->hide();
 
-	_gridGroup = new QGraphicsItemGroup;
-	_scene->addItem(_gridGroup);
-
 	QRectF scene_rect = QRectF(_xmin, _ymin, _xmax - _xmin, _ymax - _ymin);
 
+	_graticule = new GraticuleItem(scene_rect);
+	_scene->addItem(_graticule);
+
 	_scene->setSceneRect(scene_rect);
 
 	_zoomRectStack.push(scene_rect);
@@ -139,9 +252,33 @@ QMicroMap::QMicroMap(SpatiaLiteDB& db, double xmin, double ymin, double xmax,
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 QMicroMap::~QMicroMap() {
+	// the loader reads the features, so it must be stopped first
+	delete _loader;
 	for (unsigned int i = 0; i < _features.size(); i++) {
 		delete _features[i];
 	}
+	delete _connection;
+	delete _dbPool;
+	// the tile workers use the store
+	delete _tiles;
+	delete _tileStore;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+SpatiaLiteConnection& QMicroMap::connection() {
+	if (!_connection) {
+		_connection = new SpatiaLiteConnection(_dbPath);
+	}
+	return *_connection;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+SpatiaLiteDBPool& QMicroMap::dbPool() {
+	if (!_dbPool) {
+		_dbPool = new SpatiaLiteDBPool(_dbPath, QMicroMapLoader::defaultThreads(_features.size()));
+		_loadThreads.setMaxThreadCount(_dbPool->size());
+	}
+	return *_dbPool;
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
@@ -170,16 +307,28 @@ void QMicroMap::selectFeatures() {
 	all_features.push_back(
 			new LineFeature("coastline",                           "red"));
 
-	// get the names of tables containing geometry
-	std::vector < std::string > geo_tables;
-	try {
-		geo_tables = _db.geometryTables();
+	// the fine detail, which can go while the map is being dragged
+	for (unsigned int i = 0; i < all_features.size(); i++) {
+		std::string table = all_features[i]->_tableName;
+		all_features[i]->_detail = table == "admin_1_states_provinces_lines_shp"
+				|| table == "rivers_lake_centerlines" || table == "geographic_lines";
 	}
-	catch (std::runtime_error& err)
-	{
-		std::cerr << _db.dbPath()
-				  << ": database error loading geometry tables: "
-				  << err.what() << std::endl;
+
+	// Get the table summaries, from the sidecar if it is current, otherwise
+	// from the database.
+	std::string dbPath = _dbPath;
+	bool scanned = false;
+	if (!_metadata.read(dbPath)) {
+		try {
+			_metadata.scan(dbPath, connection());
+			scanned = true;
+		}
+		catch (std::runtime_error& err)
+		{
+			std::cerr << dbPath
+					  << ": database error loading geometry tables: "
+					  << err.what() << std::endl;
+		}
 	}
 
 	// query the tables, to verify that the feature is available
@@ -189,21 +338,536 @@ void QMicroMap::selectFeatures() {
 		std::string table = (*feature)->_tableName;
 
 		// Make sure that the requested geometry feature exists in the database.
-		std::vector<std::string>::iterator result =
-				std::find(geo_tables.begin(), geo_tables.end(), table);
-		if (result == geo_tables.end()) {
+		const TableMetadata* metadata = _metadata.table(table);
+		if (!metadata) {
 			// selected table not found in the existing tables
 			std::cerr << table << " not found" << std::endl;
 			delete *feature;
 			continue;
 		}
+		// Nothing to draw if it is all outside of the map.
+		if (!metadata->intersects(_xmin, _ymin, _xmax, _ymax)) {
+			delete *feature;
+			continue;
+		}
 		// Okay, it passed the test, so save it as one of the vetted features.
 		_features.push_back(*feature);
 	}
+
+	selectLevelsOfDetail();
+
+	// The query plans are only asked for when the database has changed; the
+	// sidecar keeps the answer, along with the rest of the metadata.
+	checkQueryPlans(scanned);
+	if (scanned && !_metadata.write()) {
+		std::cerr << MapMetadata::sidecarPath(dbPath)
+				  << ": unable to save the table metadata" << std::endl;
+	}
+
+	_geometryCache.open(dbPath, _xmin, _ymin, _xmax, _ymax);
+
+	_featureTables.resize(_features.size());
+	_drawnTables.resize(_features.size());
+	_layerItems.resize(_features.size());
+	for (unsigned int i = 0; i < _features.size(); i++) {
+		_featureTables[i] = _features[i]->_tableName;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::selectLevelsOfDetail() {
+
+	const std::vector<MapMetadata::Lod>& lods = _metadata.lods();
+
+	for (unsigned int i = 0; i < lods.size(); i++) {
+		if (!_metadata.table(lods[i]._lodTable)) {
+			std::cerr << lods[i]._lodTable << " not found" << std::endl;
+			continue;
+		}
+		for (unsigned int f = 0; f < _features.size(); f++) {
+			if (_features[f]->_tableName == lods[i]._table) {
+				_features[f]->_lodTables[lods[i]._tolerance] = lods[i]._lodTable;
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @return The memory taken by the decimated and clipped geometry of the
+/// LayerItems among some items.
+/// @param items The items.
+static qint64 derivedBytes(const QList<QGraphicsItem*>& items) {
+
+	qint64 bytes = 0;
+	for (int i = 0; i < items.size(); i++) {
+		LayerItem* item = dynamic_cast<LayerItem*>(items[i]);
+		if (item) {
+			bytes += item->derivedBytes();
+		}
+	}
+	return bytes;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @return True if an EXPLAIN QUERY PLAN reads every row of a table.
+/// @param plan The detail column of the plan.
+/// @param table The table name.
+static bool fullScan(const std::vector<std::string>& plan, const std::string& table) {
+
+	QString name = QString::fromStdString(table);
+
+	for (unsigned int i = 0; i < plan.size(); i++) {
+		// "SCAN TABLE lakes" in older versions of sqlite, "SCAN lakes" in newer
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+		QStringList words = QString::fromStdString(plan[i]).split(' ', Qt::SkipEmptyParts);
+#else
+		QStringList words = QString::fromStdString(plan[i]).split(' ', QString::SkipEmptyParts);
+#endif
+		if (words.size() < 2 || words[0] != "SCAN") {
+			continue;
+		}
+		int w = (words[1] == "TABLE" && words.size() > 2) ? 2 : 1;
+		if (words[w].compare(name, Qt::CaseInsensitive) == 0 && !words.contains("VIRTUAL")) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::checkQueryPlans(bool explain) {
+
+	for (unsigned int f = 0; f < _features.size(); f++) {
+		Feature* feature = _features[f];
+
+		std::vector<std::string> tables;
+		tables.push_back(feature->_tableName);
+		for (std::map<double, std::string>::iterator lod = feature->_lodTables.begin();
+				lod != feature->_lodTables.end(); lod++) {
+			tables.push_back(lod->second);
+		}
+
+		for (unsigned int t = 0; t < tables.size(); t++) {
+			std::string sql;
+			std::vector<std::string> plan;
+			if (explain) {
+				try {
+					SpatiaLiteConnection& db = connection();
+					sql = db.geometryQuery(tables[t], feature->_geometryName, feature->_nameColumn);
+					plan = db.queryPlan(sql);
+					_metadata.setFullScan(tables[t], fullScan(plan, tables[t]));
+				} catch (std::runtime_error& err) {
+					std::cerr << _dbPath
+							  << ": database error checking the query plan: "
+							  << err.what() << std::endl;
+				}
+			}
+
+			const TableMetadata* metadata = _metadata.table(tables[t]);
+			if (metadata && metadata->_fullScan) {
+				std::cerr << "warning: " << tables[t]
+						  << " has no spatial index, and every query will scan the whole table"
+						  << " (see QMicroMap::createSpatialIndexes())" << std::endl;
+				if (sql.size()) {
+					std::cerr << "  " << sql << std::endl;
+				}
+				for (unsigned int i = 0; i < plan.size(); i++) {
+					std::cerr << "  " << plan[i] << std::endl;
+				}
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int QMicroMap::createSpatialIndexes() {
+
+	int created = 0;
+
+	try {
+		SpatiaLiteConnection db(_dbPath, false);
+
+		for (unsigned int f = 0; f < _features.size(); f++) {
+			Feature* feature = _features[f];
+
+			std::vector<std::string> tables;
+			tables.push_back(feature->_tableName);
+			for (std::map<double, std::string>::iterator lod = feature->_lodTables.begin();
+					lod != feature->_lodTables.end(); lod++) {
+				tables.push_back(lod->second);
+			}
+
+			for (unsigned int t = 0; t < tables.size(); t++) {
+				if (db.spatialIndex(tables[t], feature->_geometryName) == SpatiaLiteConnection::INDEX_RTREE) {
+					continue;
+				}
+				std::cerr << "creating a spatial index for " << tables[t] << std::endl;
+				// builds and fills the R*Tree, and marks the column as indexed
+				db.query("SELECT CreateSpatialIndex("
+						+ SpatiaLiteConnection::quote(tables[t]) + ", "
+						+ SpatiaLiteConnection::quote(feature->_geometryName) + ")");
+				_metadata.setSpatialIndex(tables[t], SpatiaLiteConnection::INDEX_RTREE);
+				_metadata.setFullScan(tables[t], false);
+				created++;
+			}
+		}
+	} catch (std::runtime_error& err) {
+		std::cerr << _dbPath
+				  << ": database error creating spatial indexes: "
+				  << err.what() << std::endl;
+	}
+
+	if (created) {
+		// the read connection has remembered that there were no indexes
+		delete _connection;
+		_connection = 0;
+		_metadata.write();
+	}
+
+	return created;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Order layer requests by the number of vertices in their table.
+class FewestVertices {
+public:
+	FewestVertices(const MapMetadata& metadata):
+		_metadata(metadata) {
+	}
+	bool operator()(const LayerRequest& a, const LayerRequest& b) const {
+		return vertices(a) < vertices(b);
+	}
+	long vertices(const LayerRequest& r) const {
+		const TableMetadata* t = _metadata.table(r._table);
+		return t ? t->_vertices : 0;
+	}
+protected:
+	const MapMetadata& _metadata;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::planLoad(std::vector<LayerRequest>& requests) {
+
+	// Drop the requests with nothing to find. What they would have replaced,
+	// drawn from the previous table, is replaced with nothing.
+	std::vector<LayerRequest> wanted;
+	for (unsigned int i = 0; i < requests.size(); i++) {
+		const TableMetadata* t = _metadata.table(requests[i]._table);
+		if (t && !t->intersects(requests[i]._xmin, requests[i]._ymin,
+				requests[i]._xmax, requests[i]._ymax)) {
+			MapLayer empty(requests[i]._index, requests[i]._page);
+			empty._table = requests[i]._table;
+			drawLayer(empty);
+			continue;
+		}
+		wanted.push_back(requests[i]);
+	}
+
+	// the small layers are quick, and the map fills in sooner
+	std::stable_sort(wanted.begin(), wanted.end(), FewestVertices(_metadata));
+
+	requests = wanted;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setLodPixelTolerance(double pixels) {
+
+	_lodPixels = pixels;
+	scheduleRedraw(DIRTY_LAYERS);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setDecimation(double pixels) {
+
+	_decimationPixels = pixels;
+
+	QList<QGraphicsItem*> items = _scene->items();
+	for (int i = 0; i < items.size(); i++) {
+		LayerItem* item = dynamic_cast<LayerItem*>(items[i]);
+		if (item) {
+			item->setDecimation(pixels);
+		}
+	}
+	invalidateBackground();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+double QMicroMap::resolution(const QRectF& viewRect) {
+
+	double w = viewport()->width();
+	double h = viewport()->height();
+	if (w < 1.0 || h < 1.0) {
+		return 0.0;
+	}
+
+	// fitInView() keeps the aspect ratio, so the larger span wins.
+	double xres = viewRect.width() / w;
+	double yres = viewRect.height() / h;
+	return xres > yres ? xres : yres;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::addDatabase(std::string dbPath, double maxSpan) {
+
+	// keep the order of decreasing span, after any database with the same span
+	unsigned int n = 0;
+	while (n < _databases.size() && _databases[n]._maxSpan >= maxSpan) {
+		n++;
+	}
+	_databases.insert(_databases.begin() + n, MapDatabase(dbPath, maxSpan));
+	if ((int)n <= _database) {
+		_database++;
+	}
+
+	scheduleRedraw(DIRTY_LAYERS);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string QMicroMap::currentDatabase() const {
+	return _dbPath;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMap::selectDatabase(const QRectF& viewRect) {
+
+	double span = qMax(fabs(viewRect.width()), fabs(viewRect.height()));
+
+	// the most detailed database that will do
+	int selected = 0;
+	for (unsigned int i = 1; i < _databases.size(); i++) {
+		if (_databases[i]._maxSpan >= span) {
+			selected = i;
+		}
+	}
+
+	if (selected == _database) {
+		return false;
+	}
+
+	useDatabase(selected);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::useDatabase(int n) {
+
+	// the loader reads the features, so it must be stopped first
+	delete _loader;
+	_loader = 0;
+
+	for (unsigned int i = 0; i < _features.size(); i++) {
+		removeLayer(i);
+		delete _features[i];
+	}
+	_features.clear();
+
+	for (std::map<PageKey, MapPage>::iterator p = _pages.begin(); p != _pages.end(); p++) {
+		removeItems(p->second._items);
+	}
+	_pages.clear();
+	_memoryUsed = 0;
+
+	// The query results are keyed by table name, which the databases share.
+	// The mapping can only be closed once its items are gone.
+	_queryCache.clear();
+	_geometryCache.close();
+	delete _connection;
+	_connection = 0;
+	delete _dbPool;
+	_dbPool = 0;
+
+	_database = n;
+	_dbPath = _databases[n]._dbPath;
+	dropFrames(true);
+
+	selectFeatures();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::updateLevelOfDetail(const QRectF& viewRect) {
+
+	selectDatabase(viewRect);
+
+	double tolerance = _lodPixels > 0.0 ? resolution(viewRect) * _lodPixels : 0.0;
+
+	if (_memoryBudget > 0) {
+		updatePages(viewRect, tolerance);
+		return;
+	}
+
+	// The whole extent, because the tiles and the caches keep a table
+	// as a whole. Paging is the way to load only the view.
+	std::vector<LayerRequest> requests;
+	for (unsigned int i = 0; i < _features.size(); i++) {
+		_featureTables[i] = _features[i]->table(tolerance);
+		if (_featureTables[i] != _drawnTables[i]) {
+			requests.push_back(LayerRequest(i, _features[i], _featureTables[i],
+					_xmin, _ymin, _xmax, _ymax));
+		}
+	}
+
+	planLoad(requests);
+	if (requests.size()) {
+		loadLayers(requests);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+qint64 QMicroMap::memoryUsed() const {
+
+	// The cached query results hold their own copies of the vertices, which
+	// may belong to pages that have been evicted. The decimated and clipped
+	// geometry comes and goes as the items are painted.
+	qint64 used = _memoryUsed + _queryCache.bytes() + LayerItem::scratchBytes();
+	for (std::map<PageKey, MapPage>::const_iterator p = _pages.begin(); p != _pages.end(); p++) {
+		used += derivedBytes(p->second._items);
+	}
+	for (unsigned int i = 0; i < _layerItems.size(); i++) {
+		used += derivedBytes(_layerItems[i]);
+	}
+	return used;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setQueryCacheBudget(qint64 bytes) {
+	_queryCache.setBudget(bytes);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+const MapLayerCache& QMicroMap::queryCache() const {
+	return _queryCache;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+qint64 QMicroMap::pageId(int level, int col, int row) {
+	return ((qint64)level << 48) | ((qint64)row << 24) | (qint64)col;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QRectF QMicroMap::pageRect(qint64 page) {
+
+	int level = page >> 48;
+	int row = (page >> 24) & 0xffffff;
+	int col = page & 0xffffff;
+
+	double w = (_xmax - _xmin) / (1 << level);
+	double h = (_ymax - _ymin) / (1 << level);
+
+	return QRectF(_xmin + col * w, _ymin + row * h, w, h);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int QMicroMap::pageLevel(const QRectF& viewRect) {
+
+	double xspan = viewRect.width() / (_xmax - _xmin);
+	double yspan = viewRect.height() / (_ymax - _ymin);
+	double span = xspan > yspan ? xspan : yspan;
+
+	int level = 0;
+	while (level < PAGE_LEVELS && (1 << level) * span < 2.0) {
+		level++;
+	}
+	return level;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::updatePages(const QRectF& viewRect, double tolerance) {
+
+	QRectF mapRect(_xmin, _ymin, _xmax - _xmin, _ymax - _ymin);
+	double dx = viewRect.width() * PAGE_MARGIN;
+	double dy = viewRect.height() * PAGE_MARGIN;
+
+	_pageLevel = pageLevel(viewRect);
+	_pageView = viewRect.normalized().adjusted(-dx, -dy, dx, dy) & mapRect;
+	_pageClock++;
+
+	// the range of pages covering the view and its margin
+	int n = 1 << _pageLevel;
+	double w = (_xmax - _xmin) / n;
+	double h = (_ymax - _ymin) / n;
+	int col0 = qBound(0, (int)((_pageView.left() - _xmin) / w), n - 1);
+	int col1 = qBound(0, (int)((_pageView.right() - _xmin) / w), n - 1);
+	int row0 = qBound(0, (int)((_pageView.top() - _ymin) / h), n - 1);
+	int row1 = qBound(0, (int)((_pageView.bottom() - _ymin) / h), n - 1);
+
+	std::vector<LayerRequest> requests;
+	for (unsigned int i = 0; i < _features.size(); i++) {
+		_featureTables[i] = _features[i]->table(tolerance);
+		for (int row = row0; row <= row1; row++) {
+			for (int col = col0; col <= col1; col++) {
+				qint64 page = pageId(_pageLevel, col, row);
+				std::map<PageKey, MapPage>::iterator p = _pages.find(PageKey(i, page));
+				if (p != _pages.end() && p->second._table == _featureTables[i]) {
+					p->second._lastUsed = _pageClock;
+					continue;
+				}
+				QRectF r = pageRect(page);
+				requests.push_back(LayerRequest(i, _features[i], _featureTables[i],
+						r.left(), r.top(), r.right(), r.bottom(), page));
+			}
+		}
+	}
+
+	// Only the current level is shown; the others would overlap it.
+	for (std::map<PageKey, MapPage>::iterator p = _pages.begin(); p != _pages.end(); p++) {
+		bool visible = (p->first.second >> 48) == _pageLevel;
+		QList<QGraphicsItem*>& items = p->second._items;
+		for (int i = 0; i < items.size(); i++) {
+			items[i]->setVisible(visible);
+		}
+	}
+	invalidateBackground();
+
+	planLoad(requests);
+	if (requests.size()) {
+		loadLayers(requests);
+	}
+
+	evictPages();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::evictPages() {
+
+	qint64 used = memoryUsed();
+
+	// The query cache is trimmed to its own budget, which is part of this one.
+	while (used > _memoryBudget) {
+
+		// find the least recently viewed page that is not in view
+		std::map<PageKey, MapPage>::iterator oldest = _pages.end();
+		for (std::map<PageKey, MapPage>::iterator p = _pages.begin(); p != _pages.end(); p++) {
+			qint64 page = p->first.second;
+			if ((page >> 48) == _pageLevel && pageRect(page).intersects(_pageView)) {
+				continue;
+			}
+			if (oldest == _pages.end() || p->second._lastUsed < oldest->second._lastUsed) {
+				oldest = p;
+			}
+		}
+
+		if (oldest == _pages.end()) {
+			// everything left is in view
+			return;
+		}
+
+		used -= oldest->second._bytes + derivedBytes(oldest->second._items);
+		removeItems(oldest->second._items);
+		_memoryUsed -= oldest->second._bytes;
+		_pages.erase(oldest);
+	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 void QMicroMap::labels(int on) {
+
+	_labelsShown = on;
+	dropFrames(true);
+
+	// endInteraction() shows them, if they are hidden for the interaction
+	if (_interacting && (_interactiveHide & HIDE_LABELS)) {
+		return;
+	}
 	if (_pointsGroup) {
 		_pointsGroup->setVisible(on);
 	}
@@ -212,58 +876,638 @@ void QMicroMap::labels(int on) {
 /////////////////////////////////////////////////////////////////////////////////////////////////
 void QMicroMap::grid(int on) {
 	_gridOn = on;
-	if (_gridGroup) {
-		_gridGroup->setVisible(on);
+	dropFrames(true);
+	if (_graticule) {
+		_graticule->setVisible(on);
 	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 void QMicroMap::drawFeatures() {
 
-	// Remove all existing items from the scene
-	_scene->clear();
+	// Forget what has been drawn, so that every feature is requested. Until
+	// the widget is laid out the viewport is small, so this usually starts
+	// with a cheap, coarse level of detail.
+	for (unsigned int i = 0; i < _features.size(); i++) {
+		_drawnTables[i] = "";
+	}
 
-	for (std::vector<Feature*>::iterator feature = _features.begin(); feature
-			!= _features.end(); feature++) {
+	updateLevelOfDetail(QRectF(_xmin, _ymin, _xmax - _xmin, _ymax - _ymin));
+}
 
-		std::string table = (*feature)->_tableName;
-		std::string geometryColumn = (*feature)->_geometryName;
-		std::string nameColumn = (*feature)->_nameColumn;
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::loadLayers(const std::vector<LayerRequest>& allRequests) {
+
+	if (_loadMode == LOAD_ASYNC) {
+		// Anything still in progress is abandoned; it belongs to an earlier view.
+		// The running queries are interrupted, so this does not wait for them.
+		delete _loader;
+		_loader = 0;
+		// the progress is reported afresh for this load
+		_loadTotal = allRequests.size();
+		_loadReported = 0;
+		_cachedTables.clear();
+	}
 
-		// query the table
-		try {
-			_db.queryGeometry(
-					table,
-					geometryColumn,
-					_xmin, _ymin, _xmax, _ymax,
-					nameColumn);
-		} catch (std::runtime_error& error) {
-			std::cout << error.what() << std::endl;
+	// draw what is cached, and query the rest
+	std::vector<LayerRequest> requests;
+	for (unsigned int i = 0; i < allRequests.size(); i++) {
+		bool cached = allRequests[i]._page < 0 && drawMappedLayer(allRequests[i]);
+		MapLayer layer;
+		if (!cached && _queryCache.find(allRequests[i], layer)) {
+			drawLayer(layer);
+			cached = true;
+		}
+		if (!cached) {
+			requests.push_back(allRequests[i]);
+		} else if (_loadMode == LOAD_ASYNC) {
+			_cachedTables.append(QString(allRequests[i]._feature->_tableName.c_str()));
 		}
+	}
 
-		SpatiaLiteDB::PointList points = _db.points();
-		SpatiaLiteDB::LinestringList linestrings = _db.linestrings();
-		SpatiaLiteDB::PolygonList polygons = _db.polygons();
+	if (_loadMode == LOAD_ASYNC && !_reportPosted) {
+		// queued ahead of the loader's first layer
+		_reportPosted = true;
+		QMetaObject::invokeMethod(this, "reportCachedSlot", Qt::QueuedConnection);
+	}
 
-		for (unsigned int i = 0; i < points.size(); i++) {
-			drawPoint(*feature, points[i], _pointsGroup);
-		}
+	if (requests.empty()) {
+		return;
+	}
 
-		for (unsigned int i = 0; i < polygons.size(); i++) {
-			drawPolygon(*feature, polygons[i]);
+	switch (_loadMode) {
+	case LOAD_SYNC:
+		try {
+			SpatiaLiteConnection& db = connection();
+			for (unsigned int i = 0; i < requests.size(); i++) {
+				MapLayer layer(requests[i]._index, requests[i]._page);
+				try {
+					QMicroMapLoader::loadLayer(db, requests[i], layer);
+				} catch (std::runtime_error& err) {
+					// not drawn or cached, so that the next update tries again
+					std::cerr << err.what() << std::endl;
+					continue;
+				}
+				_queryCache.insert(requests[i], layer);
+				drawLayer(layer);
+			}
+		} catch (std::runtime_error& err) {
+			std::cerr << err.what() << std::endl;
 		}
+		break;
 
-		for (unsigned int i = 0; i < linestrings.size(); i++) {
-			drawLinestring(*feature, linestrings[i]);
+	case LOAD_PARALLEL: {
+		// query all tables at once, then merge the results in planLoad() order
+		QMicroMapLoader loader(dbPool(), _loadThreads, requests);
+		loader.start();
+		loader.wait();
+		for (unsigned int i = 0; i < requests.size(); i++) {
+			MapLayer* layer = loader.takeLayer(i);
+			if (layer && !loader.failed(i)) {
+				_queryCache.insert(requests[i], *layer);
+				drawLayer(*layer);
+			}
+			delete layer;
 		}
+		break;
+	}
+
+	case LOAD_ASYNC:
+		// Hand the work to the loader; the layers are drawn in layerLoadedSlot().
+		// The caller requests everything that has not been drawn from its
+		// current table, so nothing that the abandoned loader was working on
+		// is lost.
+		_nextLayer = 0;
+		_loader = new QMicroMapLoader(dbPool(), _loadThreads, requests, this);
+		connect(_loader, SIGNAL(layerLoaded(int)), this, SLOT(layerLoadedSlot(int)));
+		_loader->start();
+		break;
 	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
-void QMicroMap::drawLinestring(Feature* feature, SpatiaLiteDB::Linestring& ls) {
+void QMicroMap::layerLoadedSlot(int /*n*/) {
+
+	if (!_loader) {
+		return;
+	}
+
+	// Add every layer that is now available in sequence.
+	while ((int)_nextLayer < _loader->size()) {
+		MapLayer* layer = _loader->takeLayer(_nextLayer);
+		if (!layer) {
+			// still waiting for this one
+			return;
+		}
+		// A failed layer is left undrawn, and is requested again by the next update.
+		bool failed = _loader->failed(_nextLayer);
+		if (!failed) {
+			_queryCache.insert(_loader->request(_nextLayer), *layer);
+			drawLayer(*layer);
+		}
+		delete layer;
+
+		QString table(_loader->request(_nextLayer)._feature->_tableName.c_str());
+		_nextLayer++;
+		_loadReported++;
+		if (!failed) {
+			emit layerReady(table);
+		}
+		emit loadProgress(_loadReported, _loadTotal);
+	}
+
+	// all done
+	_loader->deleteLater();
+	_loader = 0;
+	emit loadFinished();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::reportCachedSlot() {
+
+	_reportPosted = false;
+
+	for (int i = 0; i < _cachedTables.size(); i++) {
+		_loadReported++;
+		emit layerReady(_cachedTables[i]);
+		emit loadProgress(_loadReported, _loadTotal);
+	}
+	_cachedTables.clear();
+
+	// otherwise layerLoadedSlot() finishes the load
+	if (!_loader) {
+		emit loadFinished();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::drawLayer(MapLayer& layer) {
+
+	int index = layer._index;
+	Feature* feature = _features[index];
+
+	MapPage* page = 0;
+	if (layer._page >= 0) {
+		page = &_pages[PageKey(index, layer._page)];
+		removeItems(page->_items);
+		_memoryUsed -= page->_bytes;
+	} else {
+		removeLayer(index);
+	}
+	QList<QGraphicsItem*>& items = page ? page->_items : _layerItems[index];
+
+	for (int i = 0; i < layer._points.size(); i++) {
+		drawPoint(feature, layer._points[i], layer._labels[i], items, _pointsGroup);
+	}
+
+	// The polygons of a page are clipped to it, and their edges come separately.
+	bool edges = !page;
+	if (_batchLayers) {
+		drawPolygons(feature, layer._polygons, items, edges);
+		drawLinestrings(feature, layer._paths, items);
+	} else {
+		for (int i = 0; i < layer._polygons.size(); i++) {
+			drawPolygon(feature, layer._polygons[i], items, edges);
+		}
+		for (int i = 0; i < layer._paths.size(); i++) {
+			drawLinestring(feature, layer._paths[i], items);
+		}
+	}
+	drawOutlines(feature, layer._outlines, items);
+
+	stackLayer(items, index);
+
+	if (page) {
+		page->_table = layer._table;
+		page->_bytes = layer.bytes() + items.size() * ITEM_BYTES;
+		page->_lastUsed = _pageClock;
+		_memoryUsed += page->_bytes;
+		// a late arrival from an earlier zoom level
+		if ((layer._page >> 48) != _pageLevel) {
+			for (int i = 0; i < items.size(); i++) {
+				items[i]->setVisible(false);
+			}
+		}
+		evictPages();
+	} else {
+		_drawnTables[index] = layer._table;
+		tileLayer(index);
+		displayListLayer(index);
+		if (_interacting && (_interactiveHide & HIDE_DETAIL) && _features[index]->_detail) {
+			showLayer(index, false);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMap::drawMappedLayer(const LayerRequest& request) {
+
+	const MappedLayer* mapped = _geometryCache.layer(request._table,
+			request._feature->_geometryName, request._feature->_nameColumn);
+	if (!mapped) {
+		return false;
+	}
+
+	int index = request._index;
+	Feature* feature = _features[index];
+
+	removeLayer(index);
+	QList<QGraphicsItem*>& items = _layerItems[index];
+
+	for (int i = 0; i < mapped->_points; i++) {
+		drawPoint(feature, mapped->_vertices[i], mapped->label(i), items, _pointsGroup);
+	}
+
+	// one item each for all of the polygons and all of the linestrings
+	PolygonFeature* pfeature = dynamic_cast<PolygonFeature*> (feature);
+	if (pfeature && mapped->_polygons) {
+		QPen pen(pfeature->_edgeColor.c_str());
+		pen.setWidth(0);
+		MappedLayerItem* item = new MappedLayerItem(mapped, true, pen,
+				QBrush(pfeature->_baseColor.c_str()));
+		_scene->addItem(item);
+		items.append(item);
+	}
+
+	LineFeature* lfeature = dynamic_cast<LineFeature*> (feature);
+	if (lfeature && mapped->_paths) {
+		QPen pen(lfeature->_baseColor.c_str());
+		pen.setWidth(0);
+		MappedLayerItem* item = new MappedLayerItem(mapped, false, pen, Qt::NoBrush);
+		_scene->addItem(item);
+		items.append(item);
+	}
+
+	stackLayer(items, index);
+
+	_drawnTables[index] = request._table;
+	tileLayer(index);
+	displayListLayer(index);
+	if (_interacting && (_interactiveHide & HIDE_DETAIL) && _features[index]->_detail) {
+		showLayer(index, false);
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::stackLayer(QList<QGraphicsItem*>& items, int index) {
+
+	for (int i = 0; i < items.size(); i++) {
+		if (items[i]->group() == 0) {
+			items[i]->setZValue(FEATURE_Z + index);
+			// drawBackground() only follows the scene transform
+			if (!(items[i]->flags() & QGraphicsItem::ItemIgnoresTransformations)) {
+				setBaseLayer(items[i]);
+			}
+			LayerItem* layerItem = dynamic_cast<LayerItem*>(items[i]);
+			if (layerItem) {
+				layerItem->setDecimation(_decimationPixels);
+			}
+		}
+	}
+	invalidateBackground();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setBaseLayer(QGraphicsItem* item) {
+
+	item->setData(BASE_LAYER_KEY, true);
+	// drawBackground() paints it instead of the scene
+	item->setFlag(QGraphicsItem::ItemHasNoContents, _backgroundCache);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::invalidateBackground(const QRectF& rect) {
+
+	// the map has changed under the last frame
+	dropFrames(false);
+
+	if (!_backgroundCache || !_scene) {
+		return;
+	}
+
+	// a null rectangle would not invalidate anything
+	QRectF r = rect.isNull() ? QRectF(_xmin, _ymin, _xmax - _xmin, _ymax - _ymin) : rect;
+	_scene->invalidate(r, QGraphicsScene::BackgroundLayer);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setBackgroundCache(bool on) {
+
+	if (on == _backgroundCache) {
+		return;
+	}
+	_backgroundCache = on;
+
+	QList<QGraphicsItem*> items = _scene->items();
+	for (int i = 0; i < items.size(); i++) {
+		if (items[i]->data(BASE_LAYER_KEY).toBool()) {
+			items[i]->setFlag(QGraphicsItem::ItemHasNoContents, on);
+		}
+	}
+
+	setCacheMode(on ? QGraphicsView::CacheBackground : QGraphicsView::CacheNone);
+	resetCachedContent();
+	_scene->update();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::drawBackground(QPainter* painter, const QRectF& rect) {
+
+	QGraphicsView::drawBackground(painter, rect);
+
+	if (!_backgroundCache) {
+		return;
+	}
+
+	// the map layers, which the scene does not paint, in stacking order
+	QList<QGraphicsItem*> items = _scene->items(rect, Qt::IntersectsItemBoundingRect, Qt::AscendingOrder);
+
+	QStyleOptionGraphicsItem option;
+	for (int i = 0; i < items.size(); i++) {
+		QGraphicsItem* item = items[i];
+		if (!item->data(BASE_LAYER_KEY).toBool() || !item->isVisible()) {
+			continue;
+		}
+		option.exposedRect = item->mapRectFromScene(rect) & item->boundingRect();
+		option.rect = item->boundingRect().toAlignedRect();
+		painter->save();
+		painter->setTransform(item->sceneTransform(), true);
+		item->paint(painter, &option, viewport());
+		painter->restore();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::tilesUpdatedSlot(const QRectF& rect) {
+	// which also drops the last frame, if it was taken with tiles missing
+	invalidateBackground(rect);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMap::exportGeometryCache() {
+
+	std::vector<MapLayer*> layers;
+	bool ok = true;
+
+	try {
+		SpatiaLiteConnection& db = connection();
+
+		for (unsigned int f = 0; f < _features.size(); f++) {
+			Feature* feature = _features[f];
+
+			std::vector<std::string> tables;
+			tables.push_back(feature->_tableName);
+			for (std::map<double, std::string>::iterator lod = feature->_lodTables.begin();
+					lod != feature->_lodTables.end(); lod++) {
+				tables.push_back(lod->second);
+			}
+
+			for (unsigned int t = 0; t < tables.size(); t++) {
+				LayerRequest request(f, feature, tables[t], _xmin, _ymin, _xmax, _ymax);
+				MapLayer* layer = new MapLayer(f);
+				layers.push_back(layer);
+				QMicroMapLoader::loadLayer(db, request, *layer);
+			}
+		}
+	} catch (std::runtime_error& err) {
+		std::cerr << err.what() << std::endl;
+		ok = false;
+	}
+
+	if (ok) {
+		ok = GeometryCache::write(_dbPath, _xmin, _ymin, _xmax, _ymax, layers);
+		if (!ok) {
+			std::cerr << GeometryCache::cachePath(_dbPath) << ": unable to write the geometry cache" << std::endl;
+		}
+	}
+
+	for (unsigned int i = 0; i < layers.size(); i++) {
+		delete layers[i];
+	}
+
+	return ok;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMap::usesGeometryCache() const {
+	return _geometryCache.isOpen();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::tileLayer(int index) {
+
+	if (!_tiles) {
+		return;
+	}
+
+	QList<QGraphicsItem*>& items = _layerItems[index];
+	_tiles->setLayer(index, items, tileSource(index));
+	for (int i = 0; i < items.size(); i++) {
+		if (dynamic_cast<LayerItem*>(items[i])) {
+			items[i]->setVisible(false);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string QMicroMap::tileSource(int index) {
+
+	// Hashing the database reads all of it, so it is only done for a store.
+	if (!_tileStore || _metadata.contentHash().empty()) {
+		return "";
+	}
+	return _metadata.contentHash() + " " + _drawnTables[index];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setRasterTiles(bool on) {
+
+	if (on == (_tiles != 0) || (on && _memoryBudget > 0)) {
+		return;
+	}
+
+	// the tiles are drawn differently
+	dropFrames(true);
+
+	if (on) {
+		_tiles = new TilePyramidItem(QRectF(_xmin, _ymin, _xmax - _xmin, _ymax - _ymin));
+		// underneath the points, which stay as vectors
+		_tiles->setZValue(FEATURE_Z - 1.0);
+		_tiles->setStore(_tileStore);
+		_tiles->setRasterizer(_tileRasterizer);
+		setBaseLayer(_tiles);
+		// the tiles take over from the display lists
+		for (unsigned int i = 0; i < _layerItems.size(); i++) {
+			removeDisplayList(i);
+		}
+		connect(_tiles, SIGNAL(tilesUpdated(const QRectF&)), this, SLOT(tilesUpdatedSlot(const QRectF&)));
+		_scene->addItem(_tiles);
+		for (unsigned int i = 0; i < _layerItems.size(); i++) {
+			tileLayer(i);
+		}
+	} else {
+		delete _tiles;
+		_tiles = 0;
+		for (unsigned int i = 0; i < _layerItems.size(); i++) {
+			for (int j = 0; j < _layerItems[i].size(); j++) {
+				if (dynamic_cast<LayerItem*>(_layerItems[i][j])) {
+					_layerItems[i][j]->setVisible(true);
+				}
+			}
+			displayListLayer(i);
+		}
+		invalidateBackground();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setDisplayLists(bool on) {
+
+	if (on == _displayLists) {
+		return;
+	}
+	_displayLists = on;
+
+	for (unsigned int i = 0; i < _layerItems.size(); i++) {
+		if (on) {
+			displayListLayer(i);
+		} else {
+			removeDisplayList(i);
+		}
+	}
+	invalidateBackground();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMap::displayLists() const {
+	return _displayLists;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::displayListLayer(int index) {
+
+	if (!_displayLists || _tiles || _memoryBudget > 0) {
+		return;
+	}
+
+	removeDisplayList(index);
+
+	// the polygons and linestrings; the points ignore the transform, and stay as they are
+	QList<QGraphicsItem*> recorded;
+	QList<QGraphicsItem*>& items = _layerItems[index];
+	for (int i = 0; i < items.size(); i++) {
+		if (items[i]->group() == 0 &&
+				!(items[i]->flags() & QGraphicsItem::ItemIgnoresTransformations)) {
+			recorded.append(items[i]);
+		}
+	}
+	if (recorded.isEmpty()) {
+		return;
+	}
+
+	DisplayListItem* list = new DisplayListItem(recorded);
+	list->setZValue(FEATURE_Z + index);
+	setBaseLayer(list);
+	_scene->addItem(list);
+	_displayListItems[index] = list;
+
+	for (int i = 0; i < recorded.size(); i++) {
+		recorded[i]->setVisible(false);
+	}
+	invalidateBackground();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::removeDisplayList(int index) {
+
+	std::map<int, DisplayListItem*>::iterator i = _displayListItems.find(index);
+	if (i == _displayListItems.end()) {
+		return;
+	}
+	delete i->second;
+	_displayListItems.erase(i);
+
+	QList<QGraphicsItem*>& items = _layerItems[index];
+	for (int j = 0; j < items.size(); j++) {
+		if (items[j]->group() == 0 &&
+				!(items[j]->flags() & QGraphicsItem::ItemIgnoresTransformations)) {
+			items[j]->setVisible(true);
+		}
+	}
+	invalidateBackground();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMap::rasterTiles() const {
+	return _tiles != 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setTileRasterizer(bool on) {
+
+	_tileRasterizer = on;
+	if (_tiles) {
+		_tiles->setRasterizer(on);
+		dropFrames(true);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setTileStore(std::string directory, qint64 maxBytes) {
+
+	TileStore* store = new TileStore(directory, maxBytes);
+	if (_tiles) {
+		// waits for the workers to finish with the old store
+		_tiles->setStore(store);
+	}
+	delete _tileStore;
+	_tileStore = store;
+
+	// the layers drawn so far were not identified, since there was no store
+	if (_tiles) {
+		for (unsigned int i = 0; i < _drawnTables.size(); i++) {
+			if (!_drawnTables[i].empty()) {
+				_tiles->setSource(i, tileSource(i));
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::removeLayer(int index) {
+
+	if (_tiles) {
+		_tiles->removeLayer(index);
+	}
+	removeDisplayList(index);
+	removeItems(_layerItems[index]);
+	_drawnTables[index] = "";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::removeItems(QList<QGraphicsItem*>& items) {
+
+	for (int i = 0; i < items.size(); i++) {
+		// deleting an item also removes it from its group and the scene
+		delete items[i];
+	}
+	if (items.size()) {
+		invalidateBackground();
+	}
+	items.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::drawLinestrings(Feature* feature, const QVector<QPainterPath>& paths,
+		QList<QGraphicsItem*>& items) {
+
+	assert(feature);
+
+	if (paths.isEmpty()) {
+		return;
+	}
 
-	assert(feature);
-	
 	LineFeature* lfeature = dynamic_cast<LineFeature*> (feature);
 	if (!lfeature) {
 		std::cerr << "dynamic cast failed for line in " << feature->_tableName
@@ -271,27 +1515,97 @@ void QMicroMap::drawLinestring(Feature* feature, SpatiaLiteDB::Linestring& ls) {
 		return;
 	}
 
-	if (ls.size() < 2) {
+	QPen pen(lfeature->_baseColor.c_str());
+	pen.setWidth(0);
+
+	LayerItem* item = new LayerItem(paths, pen);
+
+	_scene->addItem(item);
+	items.append(item);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::drawPolygons(Feature* feature, const QVector<QPolygonF>& polygons,
+		QList<QGraphicsItem*>& items, bool edges) {
+
+	assert(feature);
+
+	if (polygons.isEmpty()) {
+		return;
+	}
+
+	PolygonFeature* pfeature = dynamic_cast<PolygonFeature*> (feature);
+	if (!pfeature) {
+		std::cerr << "dynamic cast failed for polygon in "
+				<< feature->_tableName << std::endl;
+		return;
+	}
+
+	QPen pen(pfeature->_edgeColor.c_str());
+	pen.setWidth(0);
+	if (!edges) {
+		pen = QPen(Qt::NoPen);
+	}
+	QBrush brush(pfeature->_baseColor.c_str());
+
+	LayerItem* item = new LayerItem(polygons, pen, brush);
+
+	_scene->addItem(item);
+	items.append(item);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::drawOutlines(Feature* feature, const QVector<QPainterPath>& outlines,
+		QList<QGraphicsItem*>& items) {
+
+	assert(feature);
+
+	if (outlines.isEmpty()) {
+		return;
+	}
+
+	PolygonFeature* pfeature = dynamic_cast<PolygonFeature*> (feature);
+	if (!pfeature) {
+		std::cerr << "dynamic cast failed for polygon in "
+				<< feature->_tableName << std::endl;
+		return;
+	}
+
+	QPen pen(pfeature->_edgeColor.c_str());
+	pen.setWidth(0);
+
+	LayerItem* item = new LayerItem(outlines, pen);
+
+	_scene->addItem(item);
+	items.append(item);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::drawLinestring(Feature* feature, const QPainterPath& path,
+		QList<QGraphicsItem*>& items) {
+
+	assert(feature);
+	
+	LineFeature* lfeature = dynamic_cast<LineFeature*> (feature);
+	if (!lfeature) {
+		std::cerr << "dynamic cast failed for line in " << feature->_tableName
+				<< std::endl;
 		return;
 	}
 
 	QPen pen(lfeature->_baseColor.c_str());
 	pen.setWidth(0);
-	QPainterPath path;
-	path.moveTo(ls[0]._x, ls[0]._y);
-	for (unsigned int i = 1; i < ls.size(); i++) {
-		path.lineTo(ls[i]._x, ls[i]._y);
-	}
 
 	QGraphicsPathItem* item = new QGraphicsPathItem(path);
 	item->setPen(pen);
 
 	_scene->addItem(item);
+	items.append(item);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
-void QMicroMap::drawPoint(Feature* feature, SpatiaLiteDB::Point& pt,
-		QGraphicsItemGroup* group) {
+void QMicroMap::drawPoint(Feature* feature, const QPointF& pt, const QString& label,
+		QList<QGraphicsItem*>& items, QGraphicsItemGroup* group) {
 
 	assert(feature);
 	
@@ -308,7 +1622,7 @@ void QMicroMap::drawPoint(Feature* feature, SpatiaLiteDB::Point& pt,
 	QRectF rect(-3, -3, 6, 6);
 
 	QGraphicsEllipseItem* eitem = new QGraphicsEllipseItem(rect);
-	eitem->setPos(pt._x, pt._y);
+	eitem->setPos(pt);
 	eitem->setFlag(QGraphicsItem::ItemIgnoresTransformations, true);
 
 	eitem->setPen(pen);
@@ -318,24 +1632,28 @@ void QMicroMap::drawPoint(Feature* feature, SpatiaLiteDB::Point& pt,
 	} else {
 		_scene->addItem(eitem);
 	}
+	items.append(eitem);
 
-	std::string label = pt._label;
 	if (label.size()) {
 		QGraphicsSimpleTextItem* litem = new QGraphicsSimpleTextItem(
-				label.c_str(), group);
-		litem->setPos(pt._x, pt._y);
+				label, group);
+		litem->setPos(pt);
 		litem->setFlag(QGraphicsItem::ItemIgnoresTransformations, true);
 		litem->setFont(QFont("Helvetica", 12));
 		litem->setPen(pen);
 		litem->setBrush(brush);
 		if (group) {
 			group->addToGroup(litem);
+		} else {
+			_scene->addItem(litem);
 		}
+		items.append(litem);
 	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
-void QMicroMap::drawPolygon(Feature* feature, SpatiaLiteDB::Polygon& pl) {
+void QMicroMap::drawPolygon(Feature* feature, const QPolygonF& poly,
+		QList<QGraphicsItem*>& items, bool edges) {
 
 	assert(feature);
 
@@ -350,173 +1668,280 @@ void QMicroMap::drawPolygon(Feature* feature, SpatiaLiteDB::Polygon& pl) {
 	pen.setWidth(0);
 	QBrush brush(pfeature->_baseColor.c_str());
 
-	SpatiaLiteDB::Ring extRing = pl.extRing();
-	QPolygonF poly;
-	for (unsigned int i = 0; i < extRing.size(); i++) {
-		poly << QPointF(extRing[i]._x, extRing[i]._y);
-	}
-
 	QGraphicsPolygonItem* item = new QGraphicsPolygonItem(poly);
-	item->setPen(pen);
+	item->setPen(edges ? pen : QPen(Qt::NoPen));
 	item->setBrush(brush);
 
 	_scene->addItem(item);
+	items.append(item);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 void QMicroMap::drawGrid(const QRectF viewRect) {
 
-	// get the current height of the viewport, in degrees.
-	double h = viewRect.height();
-	// get dimension of the viewport (note: y axis is inverted)
-	double xmin = viewRect.topLeft().x();
-	if (xmin < _xmin) xmin = _xmin;
-	double ymin = viewRect.topLeft().y();
-	if (ymin < _ymin) ymin = _ymin;
-	double xmax = viewRect.bottomRight().x();
-	if (xmax > _xmax) xmax = _xmax;
-	double ymax = viewRect.bottomRight().y();
-	if (ymax > _ymax) ymax = _ymax;
-
-	// determine the grid spacing. It will be 1, 2, 5, 10, 15, 30 degrees
-	// latitude.  try for approx. 5 segments in latitude.
-	double delta = h / 5.0;
-	if (delta < 1.0)
-		delta = 1.0;
-	else if (delta < 2)
-		delta = 2.0;
-	else if (delta < 5.0)
-		delta = 5.0;
-	else if (delta < 10.0)
-		delta = 10.0;
-	else if (delta < 30.0)
-		delta = 15.0;
-	else
-		delta = 30.0;
-
-	// destroy the current grid and labels
-	QList<QGraphicsItem*> gItems = _gridGroup->childItems();
-	for (int i = 0; i < gItems.size(); i++) {
-		_gridGroup->removeFromGroup(gItems[i]);
-		delete gItems[i];
-	}
-
-	// draw new grid (always over the whole scene area)
-	QPen pen("grey");
-	pen.setWidth(0);
-	QList<double> lons;
-	for (double x = _xmin; x <= _xmax; x += delta) {
-		// longitude
-		QGraphicsLineItem* line = new QGraphicsLineItem(QLineF(QPointF(x, _ymin), QPointF(x, _ymax)));
-		line->setPen(pen);
-		_gridGroup->addToGroup(line);
-		// remember the longitude grid locations
-		lons.append(x);
-	}
-	QList<double> lats;
-	for (double y = _ymin; y <= _ymax; y += delta) {
-		// latitude
-		QGraphicsLineItem* line = new QGraphicsLineItem(QLineF(QPointF(_xmin, y), QPointF(_xmax, y)));
-		line->setPen(pen);
-		_gridGroup->addToGroup(line);
-		// remember the latitude grid locations
-		lats.append(y);
-	}
-
-	// draw new labels (only draw it over the current viewport)
-	QString label;
-	int j;
-	for (j = 0; j < lons.size(); j++) {
-		// longitude
-		double x = lons[j];
-		if (x >= xmin && x <= xmax) {
-			label = QString::number(qAbs(x), 'f', 0);
-			if (x > 0) 		label += "E";
-			else if (x < 0) label += "W";
-			QGraphicsSimpleTextItem* latLabel = new QGraphicsSimpleTextItem();
-			latLabel->setText(label);
-			latLabel->setFont(QFont("helvetica", 11));
-			// turn off transformations. The label will now draw with local scale
-			latLabel->setFlag(QGraphicsItem::ItemIgnoresTransformations);
-			//double xOffset = (xmax - xmin) * 5 / 360;
-			double yOffset = (ymax - ymin) * 4 / 180;
-			latLabel->setPos(x, ymin+yOffset);
-			_gridGroup->addToGroup(latLabel);
-		}
-	}
-	for (j = 0; j < lats.size(); j++) {
-		// latitude
-		double y = lats[j];
-		if (y >= ymin && y <= ymax) {
-			label = QString::number(qAbs(y), 'f', 0);
-			if (y > 0) 		label += "N";
-			else if (y < 0) label += "S";
-			QGraphicsSimpleTextItem* lonLabel = new QGraphicsSimpleTextItem();
-			lonLabel->setText(label);
-			lonLabel->setFont(QFont("helvetica", 11));
-			// turn off transformations. The label will now draw with local scale
-			lonLabel->setFlag(QGraphicsItem::ItemIgnoresTransformations);
-			lonLabel->setPos(xmin, y);
-			_gridGroup->addToGroup(lonLabel);
-		}
-	}
-
-	// make them visible based on the current choice.
-	if (_gridOn) {
-		_gridGroup->show();
-	} else {
-		_gridGroup->hide();
+	_graticule->setView(viewRect);
+	_graticule->setVisible(_gridOn);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setAnnotation(ANNOTATION_CORNER corner, QString text) {
+
+	Annotation& annotation = _cornerAnnotations[corner];
+	annotation._newText = text;
+	annotation._changed = true;
+	scheduleRedraw(DIRTY_ANNOTATION);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setAnnotation(QString name, QPoint pos, QString text) {
+
+	if (text.isEmpty() && _freeAnnotations.find(name) == _freeAnnotations.end()) {
+		return;
+	}
+
+	Annotation& annotation = _freeAnnotations[name];
+	annotation._newText = text;
+	annotation._newPos = pos;
+	annotation._changed = true;
+	scheduleRedraw(DIRTY_ANNOTATION);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::applyAnnotations() {
+
+	for (int c = 0; c < 4; c++) {
+		Annotation& annotation = _cornerAnnotations[c];
+		if (annotation._changed) {
+			setAnnotationText(annotation, c, annotation._newText);
+		}
+	}
+
+	std::map<QString, Annotation>::iterator i = _freeAnnotations.begin();
+	while (i != _freeAnnotations.end()) {
+		Annotation& annotation = i->second;
+		if (annotation._changed) {
+			viewport()->update(annotationRect(annotation, -1));
+			annotation._pos = annotation._newPos;
+			setAnnotationText(annotation, -1, annotation._newText);
+		}
+		if (annotation._text.text().isEmpty()) {
+			_freeAnnotations.erase(i++);
+		} else {
+			i++;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setAnnotationText(Annotation& annotation, int corner, QString text) {
+
+	viewport()->update(annotationRect(annotation, corner));
+	annotation._text.setText(text);
+	annotation._text.prepare(QTransform(), _annotationFont);
+	annotation._changed = false;
+	viewport()->update(annotationRect(annotation, corner));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::beginUpdate() {
+	_updateDepth++;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::endUpdate() {
+
+	if (_updateDepth == 0) {
+		return;
+	}
+	_updateDepth--;
+	if (_updateDepth == 0 && _dirty) {
+		redraw();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::scheduleRedraw(int dirty) {
+
+	_dirty |= dirty;
+
+	// one redraw for everything asked for in this pass of the event loop
+	if (_updateDepth == 0 && !_redrawPosted) {
+		_redrawPosted = true;
+		QMetaObject::invokeMethod(this, "redrawSlot", Qt::QueuedConnection);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::redrawSlot() {
+
+	_redrawPosted = false;
+
+	// endUpdate() will do it
+	if (_updateDepth == 0) {
+		redraw();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::redraw() {
+
+	int dirty = _dirty;
+	_dirty = 0;
+
+	if (dirty & DIRTY_LAYERS) {
+		updateLevelOfDetail(_zoomRectStack.top());
+	}
+	if (dirty & DIRTY_GRID) {
+		drawGrid(_zoomRectStack.top());
+	}
+	if (dirty & DIRTY_ANNOTATION) {
+		applyAnnotations();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QRect QMicroMap::annotationRect(const Annotation& annotation, int corner) const {
+
+	if (annotation._text.text().isEmpty()) {
+		return QRect();
+	}
+
+	const int margin = 4;
+	QSize size = annotation._text.size().toSize() + QSize(2, 2);
+	int right = viewport()->width() - size.width() - margin;
+	int bottom = viewport()->height() - size.height() - margin;
+
+	QPoint pos;
+	switch (corner) {
+	case CORNER_TOP_LEFT:
+		pos = QPoint(margin, margin);
+		break;
+	case CORNER_TOP_RIGHT:
+		pos = QPoint(right, margin);
+		break;
+	case CORNER_BOTTOM_LEFT:
+		pos = QPoint(margin, bottom);
+		break;
+	case CORNER_BOTTOM_RIGHT:
+		pos = QPoint(right, bottom);
+		break;
+	default:
+		pos = annotation._pos;
+		break;
+	}
+	return QRect(pos, size);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::updateAnnotations(int dx, int dy) {
+
+	for (int c = 0; c < 4; c++) {
+		QRect r = annotationRect(_cornerAnnotations[c], c);
+		viewport()->update(r);
+		viewport()->update(r.translated(dx, dy));
+	}
+	for (std::map<QString, Annotation>::const_iterator i = _freeAnnotations.begin();
+			i != _freeAnnotations.end(); i++) {
+		QRect r = annotationRect(i->second, -1);
+		viewport()->update(r);
+		viewport()->update(r.translated(dx, dy));
 	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
-void QMicroMap::drawAnnotation(const QRectF viewRect) {
+void QMicroMap::drawForeground(QPainter* painter, const QRectF& rect) {
 
-	// get dimension of the viewport (note: y axis is inverted)
-	double xmin = viewRect.topLeft().x();
-	if (xmin < _xmin) xmin = _xmin;
-	double ymin = viewRect.topLeft().y();
-	if (ymin < _ymin) ymin = _ymin;
-	double xmax = viewRect.bottomRight().x();
-	if (xmax > _xmax) xmax = _xmax;
-	double ymax = viewRect.bottomRight().y();
-	if (ymax > _ymax) ymax = _ymax;
+	QGraphicsView::drawForeground(painter, rect);
 
-	// Remove old annotations
-	if (_topRightLabel) {
-		delete _topRightLabel;
-		_topRightLabel = 0;
+	// the frames are kept without them, since they change on their own
+	if (_capturing) {
+		return;
 	}
-	if (_topLeftLabel) {
-		delete _topLeftLabel;
-		_topLeftLabel = 0;
+
+	// in viewport pixels, whatever the scene transform
+	QRect exposed = mapFromScene(rect).boundingRect().adjusted(-1, -1, 1, 1);
+	painter->save();
+	painter->resetTransform();
+	drawAnnotations(painter, exposed);
+	painter->restore();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::drawAnnotations(QPainter* painter, const QRect& exposed) {
+
+	// Lay out the text now if the redraw is still queued, so that a grab()
+	// or render() straight after setAnnotation() shows it.
+	if (_dirty & DIRTY_ANNOTATION) {
+		_dirty &= ~DIRTY_ANNOTATION;
+		applyAnnotations();
 	}
 
-	// Create and draw the new annotations
-	QGraphicsProxyWidget *proxy;
-	if (_annotationTopRight != "") {
-		_topRightLabel = new QLabel(_annotationTopRight);
-		_topRightLabel->setFont(QFont("helvetica", 12));
-		proxy = _scene->addWidget(_topRightLabel);
-		proxy->setFlag( QGraphicsItem::ItemIgnoresTransformations, true );
-		proxy->setPos(xmax-(xmax-xmin)/8.0, ymax-(ymax-ymin)/100.0);
+	painter->setFont(_annotationFont);
+	painter->setPen(palette().color(QPalette::WindowText));
+
+	for (int c = 0; c < 4; c++) {
+		drawAnnotation(painter, _cornerAnnotations[c], c, exposed);
+	}
+	for (std::map<QString, Annotation>::const_iterator i = _freeAnnotations.begin();
+			i != _freeAnnotations.end(); i++) {
+		drawAnnotation(painter, i->second, -1, exposed);
 	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::drawAnnotation(QPainter* painter, const Annotation& annotation, int corner,
+		const QRect& exposed) {
 
-	if (_annotationTopLeft != "") {
-		_topLeftLabel = new QLabel(_annotationTopLeft);
-		_topLeftLabel->setFont(QFont("helvetica", 12));
-		proxy = _scene->addWidget(_topLeftLabel);
-		proxy->setFlag( QGraphicsItem::ItemIgnoresTransformations, true );
-		proxy->setPos(xmin + (xmax-xmin)/20.0, ymax-(ymax-ymin)/100.0);
+	QRect r = annotationRect(annotation, corner);
+	if (r.isEmpty() || !r.intersects(exposed)) {
+		return;
 	}
+	painter->fillRect(r, palette().color(QPalette::Window));
+	painter->drawStaticText(r.topLeft() + QPoint(1, 1), annotation._text);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::scrollContentsBy(int dx, int dy) {
+
+	QGraphicsView::scrollContentsBy(dx, dy);
+
+	// the scrolled pixels carry the annotations away with them
+	updateAnnotations(dx, dy);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 void QMicroMap::resizeEvent(QResizeEvent* event) {
 
+	// Keep the frame from before the resize, at full quality. The transform
+	// is not changed until the idle timer fires, so the old viewport area
+	// still shows the same part of the scene. The last frame is used if it
+	// shows that area; otherwise it is rendered, once, before QGraphicsView
+	// can move the scene in the viewport.
+	if (_resizePreview && _resizeFrame.isNull() && event->oldSize().isValid()) {
+		QSize oldSize = viewport()->size() - (event->size() - event->oldSize());
+		if (!oldSize.isEmpty()) {
+			QRect oldRect(QPoint(0, 0), oldSize);
+			if (!_lastFrame.isNull() && _lastFrame.size() / _lastFrame.devicePixelRatio() == oldSize
+					&& _lastFrameRect == mapToScene(oldRect).boundingRect()) {
+				_resizeFrame = _lastFrame;
+			} else {
+				_resizeFrame = renderFrame(oldRect);
+			}
+		}
+	}
+
 	// Call the subclass resize
 	QGraphicsView::resizeEvent(event);
 
+	beginInteraction();
+	_resizePending = true;
+
+	startIdleTimer();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::startIdleTimer() {
+
 	if (_timerId != -1) {
 		// if a timer is already active, cancel it
 		killTimer(_timerId);
@@ -534,23 +1959,331 @@ void QMicroMap::timerEvent(QTimerEvent* /*event*/) {
 	}
 	_timerId = -1;
 
-	// fit in view
-	fitInView(_zoomRectStack.top());
+	if (_resizePending) {
+		_resizePending = false;
+
+		// fit in view
+		fitInView(_zoomRectStack.top());
+
+		// the viewport size may have changed the level of detail, and
+		// the grid labels are placed in the view
+		scheduleRedraw(DIRTY_LAYERS | DIRTY_GRID);
+
+		// and paint at the new size
+		if (!_resizeFrame.isNull()) {
+			_resizeFrame = QPixmap();
+			viewport()->update();
+		}
+	}
+
+	// replace the zoom snapshot with the real thing
+	if (!_zoomFrame.isNull()) {
+		finishZoom();
+	}
+
+	// the interaction is over
+	endInteraction();
+
+	// Keep the finished frame, after the redraw that has been queued. It is
+	// what the zoom history, or the next resize, shows.
+	if (keepsFrames()) {
+		QMetaObject::invokeMethod(this, "captureFrameSlot", Qt::QueuedConnection);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setInteractiveQuality(bool on, int hide) {
+
+	if (!on) {
+		endInteraction();
+	}
+	_interactiveQuality = on;
+	_interactiveHide = hide;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMap::interacting() const {
+	return _interacting;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::beginInteraction() {
+
+	if (!_interactiveQuality || _interacting) {
+		return;
+	}
+	_interacting = true;
+
+	_fullHints = renderHints();
+	setRenderHints(_fullHints & ~(QPainter::Antialiasing | QPainter::SmoothPixmapTransform));
+
+	if ((_interactiveHide & HIDE_LABELS) && _pointsGroup) {
+		_pointsGroup->setVisible(false);
+	}
+	if (_interactiveHide & HIDE_DETAIL) {
+		for (unsigned int i = 0; i < _features.size(); i++) {
+			if (_features[i]->_detail) {
+				showLayer(i, false);
+			}
+		}
+	}
+
+	// the cached background was drawn at full quality
+	resetCachedContent();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::endInteraction() {
+
+	if (!_interacting) {
+		return;
+	}
+	_interacting = false;
+
+	setRenderHints(_fullHints);
+
+	if ((_interactiveHide & HIDE_LABELS) && _pointsGroup) {
+		_pointsGroup->setVisible(_labelsShown);
+	}
+	if (_interactiveHide & HIDE_DETAIL) {
+		for (unsigned int i = 0; i < _features.size(); i++) {
+			if (_features[i]->_detail) {
+				showLayer(i, true);
+			}
+		}
+	}
+
+	resetCachedContent();
+	viewport()->update();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setZoomFrames(qint64 maxBytes) {
+
+	_zoomFrameBudget = maxBytes;
+	if (maxBytes == 0) {
+		_zoomFrames.clear();
+	}
+	if (!keepsFrames()) {
+		_lastFrame = QPixmap();
+	} else if (_lastFrame.isNull()) {
+		startIdleTimer();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMap::showingZoomFrame() const {
+	return !_zoomFrame.isNull();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::setResizePreview(bool on) {
+
+	_resizePreview = on;
+	if (!on && !_resizeFrame.isNull()) {
+		_resizeFrame = QPixmap();
+		viewport()->update();
+	}
+	if (!keepsFrames()) {
+		_lastFrame = QPixmap();
+	} else if (_lastFrame.isNull()) {
+		startIdleTimer();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMap::keepsFrames() const {
+	return _zoomFrameBudget > 0 || _resizePreview;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::captureZoomFrame() {
+
+	if (_zoomFrameBudget == 0) {
+		return;
+	}
+
+	unsigned int top = _zoomRectStack.size() - 1;
+	_zoomFrames.resize(top + 1);
+	_zoomFrames[top] = QPixmap();
+	if (!_lastFrame.isNull() && _lastFrameRect == mapToScene(viewport()->rect()).boundingRect()) {
+		_zoomFrames[top] = _lastFrame;
+	}
+
+	// drop the oldest snapshots above the full extent, then the full extent,
+	// and lastly this one
+	std::vector<unsigned int> order;
+	for (unsigned int i = 1; i < top; i++) {
+		order.push_back(i);
+	}
+	if (top > 0) {
+		order.push_back(0);
+	}
+	order.push_back(top);
+
+	qint64 bytes = 0;
+	for (unsigned int i = 0; i < _zoomFrames.size(); i++) {
+		const QPixmap& frame = _zoomFrames[i];
+		bytes += (qint64)frame.width() * frame.height() * frame.depth() / 8;
+	}
+	for (unsigned int n = 0; n < order.size() && bytes > _zoomFrameBudget; n++) {
+		QPixmap& frame = _zoomFrames[order[n]];
+		bytes -= (qint64)frame.width() * frame.height() * frame.depth() / 8;
+		frame = QPixmap();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::captureFrameSlot() {
+	captureFrame();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::captureFrame() {
+
+	if (!keepsFrames()) {
+		return;
+	}
+
+	// the idle timer will come back when the view has settled
+	if (_interacting || _timerId != -1 || _dirty || !_zoomFrame.isNull() || !_resizeFrame.isNull()
+			|| QApplication::mouseButtons() != Qt::NoButton) {
+		return;
+	}
+
+	QRectF rect = mapToScene(viewport()->rect()).boundingRect();
+	if (!_lastFrame.isNull() && rect == _lastFrameRect) {
+		return;
+	}
+
+	_lastFrame = renderFrame(viewport()->rect());
+	_lastFrameRect = rect;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QPixmap QMicroMap::renderFrame(const QRect& rect) {
+
+	qreal ratio = viewport()->devicePixelRatioF();
+	QPixmap frame(rect.size() * ratio);
+	frame.setDevicePixelRatio(ratio);
+	frame.fill(viewport()->palette().color(viewport()->backgroundRole()));
+
+	QPainter painter(&frame);
+	_capturing = true;
+	render(&painter, QRectF(QPointF(0.0, 0.0), rect.size()), rect);
+	_capturing = false;
+
+	return frame;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::dropFrames(bool history) {
+
+	_lastFrame = QPixmap();
+	if (history) {
+		_zoomFrames.clear();
+	}
+
+	// The idle timer takes it again once things have settled. During an
+	// interaction, it is started when the interaction stops.
+	if (keepsFrames() && _timerId == -1 && !_interacting) {
+		startIdleTimer();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMap::showZoomFrame() {
+
+	// the entries above the top have been popped
+	unsigned int top = _zoomRectStack.size() - 1;
+	if (_zoomFrames.size() > top + 1) {
+		_zoomFrames.resize(top + 1);
+	}
+	if (_zoomFrames.size() <= top || _zoomFrames[top].isNull()) {
+		return false;
+	}
+	const QPixmap& frame = _zoomFrames[top];
+	if (frame.size() / frame.devicePixelRatio() != viewport()->size()) {
+		return false;
+	}
+
+	_zoomFrame = frame;
+	viewport()->update();
+	startIdleTimer();
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::finishZoom() {
 
-	// draw the grid
-	drawGrid(_zoomRectStack.top());
+	_zoomFrame = QPixmap();
+	scheduleRedraw(DIRTY_LAYERS | DIRTY_GRID);
+	viewport()->update();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::paintEvent(QPaintEvent* event) {
+
+	if (!_zoomFrame.isNull()) {
+		QPainter painter(viewport());
+		painter.drawPixmap(0, 0, _zoomFrame);
+		drawAnnotations(&painter, event->rect());
+		return;
+	}
+
+	if (!_resizeFrame.isNull()) {
+		// fitInView() stretches the zoom rectangle to the viewport in the same way
+		QPainter painter(viewport());
+		painter.drawPixmap(viewport()->rect(), _resizeFrame);
+		// the annotations keep their size, and move with the corners
+		drawAnnotations(&painter, event->rect());
+		return;
+	}
+
+	QGraphicsView::paintEvent(event);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMap::showLayer(int index, bool on) {
+
+	// the pages of a paged map have their own visibility
+	if (_memoryBudget > 0) {
+		return;
+	}
 
-	// add annotation
-	drawAnnotation(_zoomRectStack.top());
+	std::map<int, DisplayListItem*>::iterator list = _displayListItems.find(index);
+	bool listed = list != _displayListItems.end();
+	if (listed) {
+		list->second->setVisible(on);
+	}
+
+	QList<QGraphicsItem*>& items = _layerItems[index];
+	for (int i = 0; i < items.size(); i++) {
+		QGraphicsItem* item = items[i];
+		if (item->group() != 0 || (item->flags() & QGraphicsItem::ItemIgnoresTransformations)) {
+			continue;
+		}
+		// the ones that the tiles or the display list stand in for stay hidden
+		bool tiled = _tiles && dynamic_cast<LayerItem*>(item);
+		item->setVisible(on && !tiled && !listed);
+	}
+	invalidateBackground();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 void QMicroMap::mousePressEvent(QMouseEvent *event) {
 
+	// the view must be up to date before it is moved again
+	if (!_zoomFrame.isNull()) {
+		finishZoom();
+	}
+
 	switch (_mouseMode) {
 	case MOUSE_ZOOM:
 		_rbOrigin = event->pos();
 		if (event->button() == Qt::LeftButton) {
+			captureZoomFrame();
+			beginInteraction();
 			if (!_rubberBand)
 				_rubberBand = new QRubberBand(QRubberBand::Rectangle, this);
 			_rubberBand->setGeometry(QRect(_rbOrigin, QSize()));
@@ -559,6 +2292,12 @@ void QMicroMap::mousePressEvent(QMouseEvent *event) {
 		break;
 
 	case MOUSE_PAN:
+		if (event->button() == Qt::LeftButton) {
+			captureZoomFrame();
+			beginInteraction();
+		}
+		QGraphicsView::mousePressEvent(event);
+		break;
 	case MOUSE_SELECT:
 		QGraphicsView::mousePressEvent(event);
 		break;
@@ -595,8 +2334,9 @@ void QMicroMap::mouseReleaseEvent(QMouseEvent *event) {
 			_zoomRectStack.pop();
 			QRectF scenerect = _zoomRectStack.top();
 			fitInView(scenerect);
-			drawGrid(scenerect);
-			drawAnnotation(scenerect);
+			if (!showZoomFrame()) {
+				finishZoom();
+			}
 		}
 		// Hide rubber band after right button is clicked and released
 		if (_rubberBand)
@@ -647,9 +2387,8 @@ void QMicroMap::mouseReleaseEvent(QMouseEvent *event) {
 			if ((bandh / viewh > 0.05) && (bandw / vieww > 0.05)) {
 				QRectF scenerect = mapToScene(bandrect).boundingRect();
 				fitInView(scenerect);
-				drawGrid(scenerect);
-				drawAnnotation(scenerect);
 				_zoomRectStack.push(scenerect);
+				scheduleRedraw(DIRTY_LAYERS | DIRTY_GRID);
 			}
 			//else
 			//	std::cout << "Room in too much!" << std::endl;
@@ -658,11 +2397,9 @@ void QMicroMap::mouseReleaseEvent(QMouseEvent *event) {
 		case MOUSE_PAN: {
 			// get the current span of the viewport
 			QRectF viewRect = mapToScene(viewport()->geometry()).boundingRect();
-			// draw the grid
-			drawGrid(viewRect);
-			// add annotation
-			drawAnnotation(viewRect);
 			_zoomRectStack.push(viewRect);
+			// page in the newly exposed area, and draw the grid
+			scheduleRedraw(DIRTY_LAYERS | DIRTY_GRID);
 			QGraphicsView::mouseReleaseEvent(event);
 			break;
 		}
@@ -672,6 +2409,12 @@ void QMicroMap::mouseReleaseEvent(QMouseEvent *event) {
 		}
 	}
 
+	// full quality, and the frame for the zoom history, once the map has
+	// been still for a moment
+	if (_interacting || keepsFrames()) {
+		startIdleTimer();
+	}
+
 	return;
 }
 
@@ -728,24 +2471,20 @@ void QMicroMap::reset() {
 	QRectF scenerect = _zoomRectStack.top();
 	fitInView(scenerect);
 
-	// redraw the grid
-	drawGrid(scenerect);
-
-	// add the annotation
-	drawAnnotation(scenerect);
+	// back to the coarse level of detail, and redraw the grid, unless the
+	// full extent snapshot can be shown meanwhile
+	if (!showZoomFrame()) {
+		finishZoom();
+	}
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 void QMicroMap::setTopRightAnnotation(QString text)
 {
-	_annotationTopRight = text;
-	drawGrid(_zoomRectStack.top());
-	drawAnnotation(_zoomRectStack.top());
+	setAnnotation(CORNER_TOP_RIGHT, text);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 void QMicroMap::setTopLeftAnnotation(QString text) {
-	_annotationTopLeft = text;
-	drawGrid(_zoomRectStack.top());
-	drawAnnotation(_zoomRectStack.top());
+	setAnnotation(CORNER_TOP_LEFT, text);
 }
@@ -9,14 +9,31 @@
 #define QMICROMAP_H_
 
 #include <QtWidgets/QGraphicsView>
-#include <QtWidgets/QLabel>
 #include <QtWidgets/QRubberBand>
 #include <QtWidgets/QGraphicsItemGroup>
-#include <QtWidgets/QGraphicsProxyWidget>
+#include <QtGui/QStaticText>
+#include <QtGui/QPixmap>
+#include <QtCore/QThreadPool>
+#include <QtCore/QStringList>
 #include <stack>
 #include <vector>
+#include <map>
 #include <string>
 #include "SpatialDB/SpatiaLiteDB.h"
+#include "MapLayerCache.h"
+#include "MapMetadata.h"
+#include "GeometryCache.h"
+
+class TilePyramidItem;
+class DisplayListItem;
+class GraticuleItem;
+class TileStore;
+
+class MapLayer;
+class LayerRequest;
+class QMicroMapLoader;
+class SpatiaLiteConnection;
+class SpatiaLiteDBPool;
 
 /////////////////////////////////////////////////////////////////////
 /// @brief A property manager for features to be rendered on the map,
@@ -39,6 +56,12 @@ public:
 			std::string nameColumn = "");
 	/// Destructor
 	virtual ~Feature();
+	/// Choose the table to draw from at a given map resolution. This is the
+	/// coarsest level of detail table whose tolerance does not exceed the
+	/// resolution, or the full resolution table if there is none.
+	/// @param resolution The largest acceptable simplification, in degrees.
+	/// @return The table name.
+	std::string table(double resolution) const;
 	/// The database table name.
 	std::string _tableName;
 	/// The default color for this feature.
@@ -47,6 +70,12 @@ public:
 	std::string _geometryName;
 	/// The name of the column containing a name or identifier. Blank if none.
 	std::string _nameColumn;
+	/// Simplified copies of the table, as built by mapcompile, keyed by
+	/// their simplification tolerance in degrees.
+	std::map<double, std::string> _lodTables;
+	/// True for a layer of fine detail, which may be hidden while the
+	/// map is being dragged (see QMicroMap::setInteractiveQuality()).
+	bool _detail;
 };
 
 /// @brief A Point feature.
@@ -112,6 +141,42 @@ public:
 	std::string _edgeColor;
 };
 
+/////////////////////////////////////////////////////////////////////
+/// @brief The graphics items of one feature on one page of a paged map.
+class MapPage {
+public:
+	/// Constructor
+	MapPage();
+	/// Destructor
+	virtual ~MapPage();
+	/// The graphics items.
+	QList<QGraphicsItem*> _items;
+	/// The table that the items were drawn from.
+	std::string _table;
+	/// The estimated memory used by the items, in bytes.
+	qint64 _bytes;
+	/// The value of QMicroMap::_pageClock when the page was last in view.
+	quint64 _lastUsed;
+};
+
+/////////////////////////////////////////////////////////////////////
+/// @brief One of the databases that a QMicroMap draws from, and the
+/// largest view it is used for.
+class MapDatabase {
+public:
+	/// Constructor
+	/// @param dbPath Path to the database.
+	/// @param maxSpan The largest view, in degrees, that the database is used for.
+	MapDatabase(std::string dbPath, double maxSpan);
+	/// Destructor
+	virtual ~MapDatabase();
+	/// Path to the database.
+	std::string _dbPath;
+	/// The database is used when neither side of the view is longer
+	/// than this, in degrees.
+	double _maxSpan;
+};
+
 /////////////////////////////////////////////////////////////////////
 /// @brief Render a geographical database on a QGraphicsView.
 /// Certain geographical features within that a specified bounding
@@ -136,6 +201,84 @@ public:
 /// QGraphicsPathItem), and adding them to the QGraphicsScene. Users can access
 /// the scene via QMicroMap.scene().
 ///
+/// The features may be loaded serially, in the constructor (LOAD_SYNC), in
+/// parallel but still within the constructor (LOAD_PARALLEL), or
+/// asynchronously (LOAD_ASYNC). In the latter two cases the database queries
+/// and the geometry conversion are done by a QMicroMapLoader, one feature per
+/// worker thread, each with its own database connection. The threads and
+/// connections are kept for the next load, until the database changes. The
+/// finished layers are added to the scene in the GUI thread, one at a time,
+/// and in the order chosen by planLoad(): the layers with the fewest vertices
+/// come first. The stacking of the layers still follows _features. In
+/// LOAD_ASYNC mode the layers are added as they arrive, and the loadProgress(),
+/// layerReady() and loadFinished() signals let the host application follow along.
+///
+/// If the database contains level of detail tables built by the mapcompile
+/// utility, the features are read from the coarsest copy that is still
+/// accurate to within a fraction of a pixel (see setLodPixelTolerance()) at the
+/// current zoom level. The choice is revisited whenever the zoom changes, and
+/// features whose table changes are reloaded. Unless the map is paged, a table
+/// is always read for the whole map extent, even when the view is a small
+/// part of it: the raster tiles, the tile store and the geometry cache hold
+/// a table as a whole, and panning never has to wait for the database. The
+/// cost is that a deep zoom reads the finest table in full, so databases
+/// whose finest tables are too big for that should be paged.
+///
+/// For databases which are too big to hold in memory, such as OpenStreetMap
+/// extracts, a memory budget may be given to the constructor. The map is then
+/// divided into pages, on a grid which is halved at each zoom level, and only
+/// the pages covering the view plus a margin are read from the database when the
+/// view is zoomed or panned. Pages which leave the view are kept for a quick
+/// return, until the budget is exceeded; then the least recently viewed pages are
+/// deleted. The pages in view are never deleted, so the memory used can exceed
+/// the budget when the view itself does not fit in it. Level of detail tables
+/// are what keep the view small when zoomed out. Geometry which crosses a page
+/// edge is clipped to each page, so it is held and drawn only once.
+///
+/// The extent, size and indexing of each table are read from a MapMetadata
+/// sidecar file next to the database, which is created on the first run. It is
+/// used to skip tables and pages which have nothing to draw, and to load the
+/// smallest layers first.
+///
+/// The polygons of a feature are drawn as a single LayerItem, and so are its
+/// linestrings, which keeps the scene small. Points are separate items, since
+/// they carry labels.
+///
+/// With setRasterTiles(), the polygons and linestrings are drawn from a
+/// TilePyramidItem instead, which renders them into raster tiles in worker
+/// threads, so that a pan or zoom only blits images. The vector items are kept,
+/// hidden, and are shown again when the tiles are turned off. setTileStore()
+/// keeps the tiles on disk as well, where later sessions, and other processes
+/// drawing the same map, find them instead of rendering them again.
+///
+/// The polygons and linestrings (or the raster tiles) never change while
+/// the view stands still, so they are painted in drawBackground(), which the
+/// view caches (QGraphicsView::CacheBackground). The scene itself only paints
+/// the overlays: points, labels, the grid and any items added by the user, such
+/// as station models. Hovering over an overlay item repaints it over the cached
+/// background, rather than every polygon underneath it. The cache is redrawn
+/// when the transform or size of the view changes, or the layers change.
+/// See setBackgroundCache().
+///
+/// Text annotations are not in the scene at all. They are pinned to the
+/// viewport corners, or to other viewport positions, and painted over the
+/// scene by drawForeground(). See setAnnotation().
+///
+/// If a GeometryCache file for the database exists, and covers the map, the
+/// whole map layers are drawn directly from its memory mapping instead of
+/// being read from the database. The file is made by exportGeometryCache().
+///
+/// More detailed databases may be added with addDatabase(), each with the
+/// largest view it is used for. For instance, the Natural Earth 1:50m
+/// database can be given to the constructor, and the 1:10m database added for
+/// views smaller than 30 degrees. The map switches to the most detailed database
+/// whose span covers the top of the zoom stack, and back again when zooming out.
+/// A database is not opened until it is first needed. The databases should contain
+/// the same feature tables.
+///
+/// Query results are kept in a MapLayerCache, so that returning to an area, zoom
+/// level or level of detail that was seen recently does not touch the database.
+///
 /// The Feature is the basic element that is rendered. It corresponds to one geometric
 /// feature type found in the database, such as an administrative boundary, a lake,
 /// a coast line, etc.
@@ -157,6 +300,30 @@ public:
 		/// The mouse is used for zooming.
 		MOUSE_ZOOM
 	};
+	/// What setInteractiveQuality() hides during interaction. Bit fields.
+	enum INTERACTIVE_HIDE {
+		HIDE_LABELS = 1,
+		HIDE_DETAIL = 2
+	};
+	/// The viewport corners where an annotation can be pinned.
+	enum ANNOTATION_CORNER {
+		CORNER_TOP_LEFT,
+		CORNER_TOP_RIGHT,
+		CORNER_BOTTOM_LEFT,
+		CORNER_BOTTOM_RIGHT
+	};
+	/// How the features are loaded from the database.
+	enum LOAD_MODE {
+		/// Load and draw all features before the constructor returns,
+		/// one after another, in the GUI thread.
+		LOAD_SYNC,
+		/// Load all features in parallel worker threads, and draw them
+		/// before the constructor returns.
+		LOAD_PARALLEL,
+		/// Load the features in parallel worker threads, and add them to the
+		/// scene as they become available.
+		LOAD_ASYNC
+	};
 
 	/// Constructor
 	/// @param db The geographic database.
@@ -166,18 +333,141 @@ public:
 	/// @param ymax The bounding box maximum latitude, in decimal degrees.
 	/// @param backGroundColor The background color of the map.
 	/// @param parent The parent widget.
+	/// @param loadMode Load the features serially, in parallel, or in the background.
+	/// @param memoryBudget If non-zero, page the geometry in as the view changes,
+	/// and evict the pages that are out of view while memoryUsed() is over this
+	/// many bytes. A quarter of it goes to the query cache. The pages in view
+	/// are always kept, even if they alone exceed it. Zero loads the whole map.
 	QMicroMap(SpatiaLiteDB& db,
 			double xmin,
 			double ymin,
 			double xmax,
 			double ymax,
 			std::string backGroundColor = "white",
-			QWidget* parent = 0);
+			QWidget* parent = 0,
+			LOAD_MODE loadMode = LOAD_SYNC,
+			qint64 memoryBudget = 0);
 	/// Destructor
 	virtual ~QMicroMap();
 	/// Set the mouse interaction mode.
 	/// @param mode The mouse mode.
 	void setMouseMode(MOUSE_MODE mode);
+	/// Set the largest simplification, in screen pixels, that is acceptable
+	/// when choosing a level of detail table. The default is one pixel.
+	/// @param pixels The tolerance in pixels. Zero or less always uses
+	/// the full resolution tables.
+	void setLodPixelTolerance(double pixels);
+	/// Set the distance, in screen pixels, within which consecutive vertices
+	/// of the polygons and linestrings are dropped as they are painted (see
+	/// LayerItem::setDecimation()). The default is half a pixel.
+	/// @param pixels The tolerance in pixels. Zero paints every vertex.
+	void setDecimation(double pixels);
+	/// @return The estimated memory used by the pages of a paged map, the
+	/// cached query results, and the decimated and clipped geometry and
+	/// working space that the LayerItems keep, in bytes.
+	qint64 memoryUsed() const;
+	/// Set the memory allowed for cached query results. The default is 64 MB,
+	/// or a quarter of the memory budget of a paged map. The cache counts
+	/// towards the memory budget, so a larger share leaves less for the pages.
+	/// @param bytes The budget in bytes. Zero disables the cache.
+	void setQueryCacheBudget(qint64 bytes);
+	/// @return The query result cache, for its statistics.
+	const MapLayerCache& queryCache() const;
+	/// Build an R*Tree spatial index for every feature table, and level of
+	/// detail table, which does not have one. The database is opened for
+	/// writing, which can take a long time on a big database; it is meant to
+	/// be done once, e.g. from an installer or a command line option.
+	/// @return The number of indexes created.
+	int createSpatialIndexes();
+	/// Write the feature tables, and their level of detail tables, for the
+	/// map extent into a GeometryCache file next to the database. It will be
+	/// used by maps created after this.
+	/// @return False if the file could not be written.
+	bool exportGeometryCache();
+	/// @return True if the GeometryCache file of the current database was
+	/// current, and is mapped for drawing from.
+	bool usesGeometryCache() const;
+	/// Add a database to draw from when the view is small enough. It is
+	/// opened when the map is first zoomed in that far.
+	/// @param dbPath Path to the database.
+	/// @param maxSpan The database is used when neither side of the view
+	/// is longer than this, in degrees, unless another database has a smaller
+	/// span which also fits.
+	void addDatabase(std::string dbPath, double maxSpan);
+	/// @return The path of the database currently drawn from.
+	std::string currentDatabase() const;
+	/// Draw the polygons and linestrings from raster tiles, which are
+	/// rendered in worker threads, or from the vector items. Points and labels
+	/// are always vectors. A paged map is always drawn from vectors.
+	/// @param on True for the raster tiles, false for the exact vector rendering.
+	void setRasterTiles(bool on);
+	/// @return True if the map is drawn from raster tiles.
+	bool rasterTiles() const;
+	/// Keep the raster tiles in a TileStore on disk, shared with other maps
+	/// and processes. The tiles are filed by the content hash of the database,
+	/// the tables, the styles and the map extent.
+	/// @param directory The store directory. Blank for TileStore::defaultDirectory().
+	/// @param maxBytes The size cap of the store. Zero for the TileStore default.
+	void setTileStore(std::string directory = "", qint64 maxBytes = 0);
+	/// Draw the raster tiles with the TileRasterizer, which is faster than
+	/// QPainter but does not antialias. The default is off.
+	/// @param on True to use the TileRasterizer.
+	void setTileRasterizer(bool on);
+	/// Draw each layer's polygons and linestrings from a display list (see
+	/// DisplayListItem), recorded when the layer is drawn. The default is off.
+	/// Ignored while raster tiles are on, and for a paged map.
+	/// @param on True to draw the layers from display lists.
+	void setDisplayLists(bool on);
+	/// @return True if the layers are drawn from display lists.
+	bool displayLists() const;
+	/// Trade quality for frame rate while the map is being dragged in
+	/// MOUSE_PAN, the rubber band is being dragged in MOUSE_ZOOM, or the
+	/// window is being resized. Antialiasing and smooth pixmap scaling are
+	/// turned off, and optionally the labels and the detail layers are hidden,
+	/// until the idle timer fires after the interaction ends. The default is on,
+	/// hiding nothing.
+	/// @param on True to lower the quality during interaction.
+	/// @param hide What to hide during interaction, from INTERACTIVE_HIDE.
+	void setInteractiveQuality(bool on, int hide = 0);
+	/// @return True if the map is drawn at the lower interactive quality at the moment.
+	bool interacting() const;
+	/// Keep a snapshot of the view for each entry of the zoom history. The
+	/// view is rendered, without the annotations, when it has been still for
+	/// a moment, and the snapshot is kept when the view is left by a zoom or
+	/// pan. Going back with the right button, or reset(), shows the snapshot
+	/// at once, with the annotations painted over it; the level of detail and
+	/// grid are brought up to date, and the view repainted, when the idle
+	/// timer fires. The snapshots are dropped when the labels, grid, database
+	/// or raster tiles change. The oldest snapshots, other than the full
+	/// extent, are dropped first to stay within the budget. The default is off.
+	/// @param maxBytes The memory allowed for the snapshots. Zero turns them off.
+	void setZoomFrames(qint64 maxBytes);
+	/// @return True if a zoom history snapshot is standing in for the view.
+	bool showingZoomFrame() const;
+	/// While the window is being resized, stretch a copy of the frame from
+	/// before the resize over the viewport, with the annotations painted over
+	/// it, instead of painting the scene at the old scale on every step. The
+	/// last frame, rendered when the view was still, is used if it is current.
+	/// The map is fitted and painted at the new size once, when the idle timer
+	/// fires after the resizing stops. The default is off.
+	/// @param on True to show the stretched frame while resizing.
+	void setResizePreview(bool on);
+	/// Paint the map layers into the cached view background, or as ordinary
+	/// scene items. The default is the cached background.
+	/// @param on True to cache the map layers with the background.
+	void setBackgroundCache(bool on);
+	/// Pin an annotation to a corner of the viewport. The annotations are
+	/// painted over the map, in viewport pixels, by drawForeground(); they
+	/// are not scene items. The text is laid out once, in the next pass of
+	/// the event loop or at endUpdate(), however often it is set before then.
+	/// @param corner The corner.
+	/// @param text The text to be displayed. Blank for none.
+	void setAnnotation(ANNOTATION_CORNER corner, QString text);
+	/// Pin an annotation to a position in the viewport.
+	/// @param name Identifies the annotation, so that it can be changed or removed.
+	/// @param pos The top left of the text, in viewport pixels.
+	/// @param text The text to be displayed. Blank to remove the annotation.
+	void setAnnotation(QString name, QPoint pos, QString text);
 
 public slots:
 	/// Turn the feature labels on and off.
@@ -188,18 +478,74 @@ public slots:
 	void grid(int on);
 	/// Reset the display to the minimum display level.
 	void reset();
-	/// Set the top right annotation
+	/// Hold back the level of detail, grid and annotation updates until the
+	/// matching endUpdate(). Calls may be nested.
+	void beginUpdate();
+	/// End a beginUpdate(). The outermost one makes every update held back
+	/// since, at once.
+	void endUpdate();
+	/// Set the top right annotation. See setAnnotation().
 	/// @param text The text to be displayed. Blank for none.
-	void setTopRightAnnotation(QString levelName);
-	/// Set the top left annotation
+	void setTopRightAnnotation(QString text);
+	/// Set the top left annotation. See setAnnotation().
 	/// @param text The text to be displayed. Blank for none.
 	void setTopLeftAnnotation(QString text);
 
 signals:
 	/// Emit this signal to inform others that the mouse mode has changed.
 	void mouseMode(QMicroMap::MOUSE_MODE);
+	/// Emitted each time a layer has been added to the scene, in LOAD_ASYNC
+	/// mode. Layers drawn from the caches count too; they are reported from
+	/// the event loop, after the call which started the load has returned.
+	/// @param loaded The number of layers added so far.
+	/// @param total The total number of layers.
+	void loadProgress(int loaded, int total);
+	/// Emitted when a layer has been added to the scene, in LOAD_ASYNC mode.
+	/// @param tableName The database table of the feature.
+	void layerReady(QString tableName);
+	/// Emitted when all layers have been added to the scene, in LOAD_ASYNC
+	/// mode. Like the other load signals, it is never emitted from within the
+	/// call which started the load, so a host can connect to it after
+	/// constructing the map.
+	void loadFinished();
+
+protected slots:
+	/// Called when tiles have been added to the tile pyramid.
+	/// @param rect The area of the tiles, in scene coordinates.
+	void tilesUpdatedSlot(const QRectF& rect);
+	/// Called when the loader has finished a layer. Layers are added
+	/// to the scene strictly in the order of the loader's requests, as
+	/// sorted by planLoad(), so a layer that completes early waits for its
+	/// predecessors.
+	/// @param n The position of the request in the loader's request list.
+	void layerLoadedSlot(int n);
+	/// Make the redraw scheduled by scheduleRedraw(), unless it is held
+	/// back by beginUpdate().
+	void redrawSlot();
+	/// Take the last frame, once the view has settled. See captureFrame().
+	void captureFrameSlot();
+	/// Report the layers of a LOAD_ASYNC load which were drawn from the
+	/// caches, and loadFinished() if nothing had to be queried. It is queued
+	/// by loadLayers(), so the signals are not lost when the load starts in
+	/// the constructor, before the host can connect to them.
+	void reportCachedSlot();
 
 protected:
+	/// What needs to be brought up to date by the next redraw(). Bit fields.
+	enum DIRTY {
+		DIRTY_GRID = 1,
+		DIRTY_ANNOTATION = 2,
+		DIRTY_LAYERS = 4
+	};
+	/// Mark parts of the map out of date. They are all brought up to date
+	/// together, by one redraw() in the next pass of the event loop, or by
+	/// endUpdate(). The zoom, pan, reset and resize handlers, and the
+	/// annotation setters, only schedule their updates here.
+	/// @param dirty The parts, from DIRTY.
+	void scheduleRedraw(int dirty);
+	/// Bring the parts marked by scheduleRedraw() up to date: the level of
+	/// detail, then the grid, then the annotations, for the top of the zoom stack.
+	void redraw();
 	/// Override the resize event, so that the grid may be redrawn.
 	/// @param event The event.
     virtual void resizeEvent(QResizeEvent* event);
@@ -222,38 +568,282 @@ protected:
     virtual void mouseDoubleClickEvent (QMouseEvent * event);
     /// Capture timer events. The timer is used to defer some drawing
     /// activities, such as fitInView(). Otherwise a recursive resizeEvent
-    /// loop can be triggered.
+    /// loop can be triggered. It also ends an interaction (see
+    /// setInteractiveQuality()).
     virtual void timerEvent(QTimerEvent *event);
+    /// Fill the background, and paint the map layers over it when they are
+    /// cached with the background.
+    /// @param painter The painter, in scene coordinates.
+    /// @param rect The area to paint, in scene coordinates.
+    virtual void drawBackground(QPainter* painter, const QRectF& rect);
+    /// Paint the annotations over the scene, pinned to the viewport.
+    /// @param painter The painter, in scene coordinates.
+    /// @param rect The area to paint, in scene coordinates.
+    virtual void drawForeground(QPainter* painter, const QRectF& rect);
+    /// Scroll the viewport, and repaint the annotations, which must not
+    /// scroll with it.
+    /// @param dx The horizontal scroll, in pixels.
+    /// @param dy The vertical scroll, in pixels.
+    virtual void scrollContentsBy(int dx, int dy);
+    /// Mark an item as part of the map layers, which are painted with the
+    /// background when it is cached.
+    /// @param item The item.
+    void setBaseLayer(QGraphicsItem* item);
+    /// Have the cached background redrawn, after the map layers have changed.
+    /// @param rect The area that changed, in scene coordinates. Null for the whole map.
+    void invalidateBackground(const QRectF& rect = QRectF());
     /// Create the features that are available in the database. These
     /// will be saved in _features. There is a possibility that some desired
-    /// features do not exist in the database.
+    /// features do not exist in the database. Features with no geometry
+    /// inside the map are left out. The tables are found from _metadata.
     void selectFeatures();
+    /// @return The connection used for queries in the GUI thread. It is
+    /// opened on the first call.
+    /// @throws std::runtime_error if the database cannot be opened.
+    SpatiaLiteConnection& connection();
+    /// @return The connections used by the loaders, with one worker thread
+    /// for each in _loadThreads. The pool is created on the first call, and
+    /// kept until the database changes.
+    SpatiaLiteDBPool& dbPool();
+    /// Find the level of detail tables for each feature, from the
+    /// qmicromap_lod table written by mapcompile, as recorded in _metadata.
+    void selectLevelsOfDetail();
+    /// Log a warning for each feature table, or level of detail table, which
+    /// will be scanned from end to end, as recorded in _metadata.
+    /// @param explain If true, first ask sqlite how each table will be queried,
+    /// record the answer in _metadata, and include the plan in the warnings.
+    /// This opens the database, so it is only done when it has been scanned.
+    void checkQueryPlans(bool explain);
+    /// Put layer requests in the order they should be loaded, smallest
+    /// table first, and remove those whose bounding box misses the table's extent.
+    /// Each removed request is drawn at once as an empty layer, so that
+    /// whatever was drawn there from another table is taken away.
+    /// @param requests The requests.
+    void planLoad(std::vector<LayerRequest>& requests);
+    /// @return The span of one screen pixel, in degrees, when viewRect is
+    /// fitted into the viewport.
+    /// @param viewRect The span of the viewport.
+    double resolution(const QRectF& viewRect);
+    /// Switch to the database that suits a new view, if it is not the one in use.
+    /// @param viewRect The span of the viewport.
+    /// @return True if the database was switched.
+    bool selectDatabase(const QRectF& viewRect);
+    /// Discard everything drawn from the current database, and select the
+    /// features of another one. The caller must then load the features.
+    /// @param n The position of the database in _databases.
+    void useDatabase(int n);
+    /// Choose the database and level of detail tables for a new view, and reload
+    /// the features whose table has changed. Outside of paged mode the whole
+    /// map extent is loaded, not just the view; see the class description.
+    /// @param viewRect The span of the viewport.
+    void updateLevelOfDetail(const QRectF& viewRect);
+    /// Choose the pages which cover a new view, and load the ones which are
+    /// missing or were drawn from a different table. Pages at other zoom levels
+    /// are hidden.
+    /// @param viewRect The span of the viewport.
+    /// @param tolerance The acceptable simplification, in degrees.
+    void updatePages(const QRectF& viewRect, double tolerance);
+    /// @return The page grid level for a view: the first at which a page is
+    /// no bigger than half of the view.
+    /// @param viewRect The span of the viewport.
+    int pageLevel(const QRectF& viewRect);
+    /// @return The identifier of a page.
+    /// @param level The page grid level; 2^level pages span the map in each direction.
+    /// @param col The page column, counting from _xmin.
+    /// @param row The page row, counting from _ymin.
+    static qint64 pageId(int level, int col, int row);
+    /// @return The area covered by a page.
+    /// @param page The page identifier.
+    QRectF pageRect(qint64 page);
+    /// Delete the least recently viewed pages until the memory used is
+    /// within the budget, sparing the pages in view.
+    void evictPages();
     /// Extract the features from the database and draw them.
-    /// xmin, ymin, xmax, ymax specifies the bounding box.
+    /// xmin, ymin, xmax, ymax specifies the bounding box. In LOAD_ASYNC
+    /// mode this only starts the loader; the drawing happens in layerLoadedSlot().
     void drawFeatures();
+    /// Load the requested layers according to _loadMode, and draw them.
+    /// Layers found in _queryCache are drawn immediately.
+    /// @param requests The layers to load.
+    void loadLayers(const std::vector<LayerRequest>& requests);
+    /// Create the graphics items for one layer and add them to the scene,
+    /// replacing any that were drawn for the same feature.
+    /// @param layer The layer to be drawn.
+    void drawLayer(MapLayer& layer);
+    /// Draw a whole map layer from _geometryCache, replacing any items that
+    /// were drawn for the same feature.
+    /// @param request The feature and table.
+    /// @return False if the table is not in the cache.
+    bool drawMappedLayer(const LayerRequest& request);
+    /// Record a layer's polygons and linestrings into a display list, and hide them,
+    /// if display lists are on.
+    /// @param index The index of the feature.
+    void displayListLayer(int index);
+    /// Delete the display list of a layer, and show its items again.
+    /// @param index The index of the feature.
+    void removeDisplayList(int index);
+    /// Start, or restart, the idle timer, which calls timerEvent().
+    void startIdleTimer();
+    /// Lower the render quality, if enabled, until endInteraction().
+    void beginInteraction();
+    /// Restore the full render quality. Called by the idle timer.
+    void endInteraction();
+    /// Keep the last frame for the top of the zoom stack, if zoom frames are
+    /// on and it still shows the view. Nothing is rendered here, so that the
+    /// interaction is not held up.
+    void captureZoomFrame();
+    /// Render the view, without the annotations, into _lastFrame, unless it
+    /// already shows the view, or the view is still changing. Only done if
+    /// keepsFrames().
+    void captureFrame();
+    /// @return True if the last frame is kept, for the zoom snapshots or the
+    /// resize preview.
+    bool keepsFrames() const;
+    /// Render part of the viewport, without the annotations, at the device
+    /// pixel ratio.
+    /// @param rect The part, in viewport pixels.
+    /// @return The frame.
+    QPixmap renderFrame(const QRect& rect);
+    /// Forget the last frame, which shows a map that has changed, and start
+    /// the idle timer to take it again.
+    /// @param history True to forget the zoom history snapshots as well.
+    void dropFrames(bool history);
+    /// Show the snapshot of the top of the zoom stack, if there is one which
+    /// fits the viewport, and start the idle timer to finish the zoom.
+    /// @return False if there is no snapshot, and the zoom must be finished now.
+    bool showZoomFrame();
+    /// Replace the snapshot with a repaint, and schedule the level of detail
+    /// and grid updates for the top of the zoom stack.
+    void finishZoom();
+    /// Paint the zoom snapshot or the stretched resize frame, with the
+    /// annotations over it, if one is showing, or else the scene.
+    /// @param event The event.
+    virtual void paintEvent(QPaintEvent* event);
+    /// Show or hide the polygons and linestrings of a layer, respecting the
+    /// raster tiles and display lists which may stand in for them.
+    /// @param index The index of the feature.
+    /// @param on True to show the layer.
+    void showLayer(int index, bool on);
+    /// Set the stacking order of the items of a feature, mark the ones which
+    /// are not in a group as map layers (see setBaseLayer()), and set the
+    /// decimation tolerance of its LayerItems.
+    /// @param items The items.
+    /// @param index The position of the feature in _features.
+    void stackLayer(QList<QGraphicsItem*>& items, int index);
+    /// Give the batched items of a feature to the tile pyramid, and hide them.
+    /// @param index The position of the feature in _features.
+    void tileLayer(int index);
+    /// @return What identifies the geometry of a feature in the TileStore: the
+    /// content hash of the database and the table drawn. Blank if there is no
+    /// store, so that the database is not hashed needlessly.
+    /// @param index The position of the feature in _features.
+    std::string tileSource(int index);
+    /// Delete the graphics items of one feature.
+    /// @param index The position of the feature in _features.
+    void removeLayer(int index);
+    /// Delete graphics items.
+    /// @param items The items. The list is emptied.
+    void removeItems(QList<QGraphicsItem*>& items);
     /// Draw a point, with the properties provided in feature.
     /// @param feature Use these properties for the rendering.
     /// @param p The point to be drawn.
+    /// @param label The point label. Blank for none.
+    /// @param items The new graphics items are appended here.
     /// @param group If group is specified, add the point to this group. This will
     /// allow a collection of points, such as place identifiers, to be set visible together.
-    void drawPoint(Feature* feature, SpatiaLiteDB::Point& p, QGraphicsItemGroup* group = 0);
+    void drawPoint(Feature* feature, const QPointF& p, const QString& label,
+    		QList<QGraphicsItem*>& items, QGraphicsItemGroup* group = 0);
     /// Draw a linestring, with the properties provided in feature.
     /// @param feature Use these properties for the rendering.
-    /// @param l The linestring to be drawn.
-    void drawLinestring(Feature* feature, SpatiaLiteDB::Linestring& l);
+    /// @param path The linestring to be drawn.
+    /// @param items The new graphics item is appended here.
+    void drawLinestring(Feature* feature, const QPainterPath& path, QList<QGraphicsItem*>& items);
+    /// Draw all of the linestrings of a layer as one LayerItem, with the
+    /// properties provided in feature.
+    /// @param feature Use these properties for the rendering.
+    /// @param paths The linestrings to be drawn.
+    /// @param items The new graphics item is appended here.
+    void drawLinestrings(Feature* feature, const QVector<QPainterPath>& paths, QList<QGraphicsItem*>& items);
+    /// Draw all of the polygons of a layer as one LayerItem, with the
+    /// properties provided in feature.
+    /// @param feature Use these properties for the rendering.
+    /// @param polygons The polygons to be drawn.
+    /// @param items The new graphics item is appended here.
+    /// @param edges False to fill the polygons only, when their edges are
+    /// drawn by drawOutlines().
+    void drawPolygons(Feature* feature, const QVector<QPolygonF>& polygons, QList<QGraphicsItem*>& items,
+    		bool edges = true);
+    /// Draw the edges of the polygons of a page, which are clipped to the page
+    /// apart from the fill, as one LayerItem in the feature's edge color.
+    /// @param feature Use these properties for the rendering.
+    /// @param outlines The edges to be drawn.
+    /// @param items The new graphics item is appended here.
+    void drawOutlines(Feature* feature, const QVector<QPainterPath>& outlines, QList<QGraphicsItem*>& items);
     /// Draw a polygon, with the properties provided in feature.
     /// @param feature Use these properties for the rendering.
-    /// @param p The polygon to be drawn.
-    void drawPolygon(Feature* feature, SpatiaLiteDB::Polygon& p);
-    /// Draw the grid. A heuristic determines the grid spacing, based
-    /// on the current span of the viewport.
+    /// @param poly The polygon to be drawn.
+    /// @param items The new graphics item is appended here.
+    /// @param edges False to fill the polygon only.
+    void drawPolygon(Feature* feature, const QPolygonF& poly, QList<QGraphicsItem*>& items,
+    		bool edges = true);
+    /// Move the grid to a new view. The GraticuleItem works out the grid
+    /// spacing, based on the current span of the viewport, when it is painted.
     /// @param viewRect Current span of viewport
     void drawGrid(const QRectF viewRect);
-    /// Draw the annotation labels
-    /// @param viewRect Current span of viewport
-    void drawAnnotation(const QRectF viewRect);
-    /// The geometric database.
+    /// An annotation, painted in viewport pixels.
+    class Annotation {
+    public:
+        Annotation(): _changed(false) {}
+        /// The laid out text.
+        QStaticText _text;
+        /// The top left of the text, for a free annotation.
+        QPoint _pos;
+        /// True if the text or position has been set since it was laid out.
+        bool _changed;
+        /// The text to lay out at the next redraw.
+        QString _newText;
+        /// The position to move to at the next redraw.
+        QPoint _newPos;
+    };
+    /// @return Where an annotation is painted, in viewport pixels.
+    /// @param annotation The annotation.
+    /// @param corner Its corner, or -1 for a free annotation.
+    QRect annotationRect(const Annotation& annotation, int corner) const;
+    /// Lay out the annotations which have changed since the last redraw, and
+    /// remove the free annotations whose text is now blank.
+    void applyAnnotations();
+    /// Set the text of an annotation, and repaint where it was and where it is.
+    /// @param annotation The annotation.
+    /// @param corner Its corner, or -1 for a free annotation.
+    /// @param text The text.
+    void setAnnotationText(Annotation& annotation, int corner, QString text);
+    /// Paint an annotation.
+    /// @param painter The painter, in viewport pixels.
+    /// @param annotation The annotation.
+    /// @param corner Its corner, or -1 for a free annotation.
+    /// @param exposed The area being painted, in viewport pixels.
+    void drawAnnotation(QPainter* painter, const Annotation& annotation, int corner,
+    		const QRect& exposed);
+    /// Paint all of the annotations, laying out any changes which are waiting
+    /// for the redraw first.
+    /// @param painter The painter, in viewport pixels.
+    /// @param exposed The area being painted, in viewport pixels.
+    void drawAnnotations(QPainter* painter, const QRect& exposed);
+    /// Repaint every annotation.
+    /// @param dx Also repaint the annotation areas shifted by this many pixels.
+    /// @param dy Also repaint the annotation areas shifted by this many pixels.
+    void updateAnnotations(int dx = 0, int dy = 0);
+    /// The geometric database given to the constructor.
 	SpatiaLiteDB& _db;
+	/// The databases, in order of decreasing _maxSpan. The first is _db.
+	std::vector<MapDatabase> _databases;
+	/// The position in _databases of the database in use.
+	int _database;
+	/// The path of the database in use.
+	std::string _dbPath;
+	/// A direct connection to the database, for queries that SpatiaLiteDB
+	/// does not provide. 0 until connection() is first called.
+	SpatiaLiteConnection* _connection;
 	/// The graphics scene which manages our drawing elements.
 	QGraphicsScene* _scene;
 	/// The zoom stack, containing the history of zoom levels.
@@ -266,23 +856,31 @@ protected:
 	double _xmax;
 	/// Maximum latitude in the scene.
 	double _ymax;
+	/// The summary of the database tables.
+	MapMetadata _metadata;
 	/// The collection of features that were vetted and verified to be in the database.
 	std::vector<Feature*> _features;
+	/// The table that each feature should currently be drawn from.
+	std::vector<std::string> _featureTables;
+	/// The table that each feature was last drawn from. Blank if not drawn.
+	std::vector<std::string> _drawnTables;
+	/// The graphics items of each feature.
+	std::vector<QList<QGraphicsItem*> > _layerItems;
+	/// The acceptable simplification, in pixels, when choosing level of detail tables.
+	double _lodPixels;
     /// The group of points. Points are used just for labels, and
 	/// grouped so that they can be toggled on and off together.
     QGraphicsItemGroup* _pointsGroup;
     /// True if the grid should be drawn.
     bool _gridOn;
-    /// The collection of grid lines.
-    QGraphicsItemGroup* _gridGroup;
-    /// Annotation to be displayed on the top right
-    QString _annotationTopRight;
-    /// Annotation to be displayed on the top left
-    QString _annotationTopLeft;
-    /// The label showing the top right annotation
-    QLabel* _topRightLabel;
-    /// The label showing the top left annotation
-    QLabel* _topLeftLabel;
+    /// The grid lines and their labels.
+    GraticuleItem* _graticule;
+    /// The annotations pinned to the viewport corners, by ANNOTATION_CORNER.
+    Annotation _cornerAnnotations[4];
+    /// The annotations at free positions, by name.
+    std::map<QString, Annotation> _freeAnnotations;
+    /// The annotation font.
+    QFont _annotationFont;
     /// The current mouse mode.
     MOUSE_MODE _mouseMode;
     /// The rubberband box used for zooming.
@@ -291,6 +889,99 @@ protected:
     QPoint _rbOrigin;
     /// The active timer id
     int _timerId;
+    /// How the features are loaded.
+    LOAD_MODE _loadMode;
+    /// The parallel loader for LOAD_ASYNC mode. 0 when not loading.
+    QMicroMapLoader* _loader;
+    /// The database connections lent to each loader. 0 until dbPool() is
+    /// first called.
+    SpatiaLiteDBPool* _dbPool;
+    /// The worker threads lent to each loader.
+    QThreadPool _loadThreads;
+    /// The index in _features of the next layer to be added to the scene.
+    unsigned int _nextLayer;
+    /// The number of layers in the current LOAD_ASYNC load.
+    int _loadTotal;
+    /// The number of them reported by loadProgress() so far.
+    int _loadReported;
+    /// The tables of the layers drawn from the caches, which reportCachedSlot()
+    /// has yet to report.
+    QStringList _cachedTables;
+    /// True while reportCachedSlot() is queued.
+    bool _reportPosted;
+    /// True to draw the polygons, and the linestrings, of a layer as one
+    /// LayerItem each. False for an item per geometry, which is only
+    /// kept for comparison by mapbench.
+    bool _batchLayers;
+    /// A page is identified by the feature index and the page identifier.
+    typedef std::pair<int, qint64> PageKey;
+    /// The memory allowed for pages. Zero if the map is not paged.
+    qint64 _memoryBudget;
+    /// The estimated memory used by _pages.
+    qint64 _memoryUsed;
+    /// The drawn pages.
+    std::map<PageKey, MapPage> _pages;
+    /// The page grid level of the current view.
+    int _pageLevel;
+    /// The current view plus the margin. Pages inside it are not evicted.
+    QRectF _pageView;
+    /// Counts the page updates, to find the least recently viewed pages.
+    quint64 _pageClock;
+    /// Recent query results.
+    MapLayerCache _queryCache;
+    /// The memory mapped layers, if there is a cache file.
+    GeometryCache _geometryCache;
+    /// The raster tiles. 0 when the map is drawn from vectors.
+    TilePyramidItem* _tiles;
+    /// The on disk raster tiles. 0 for none.
+    TileStore* _tileStore;
+    /// True if the raster tiles are drawn with the TileRasterizer.
+    bool _tileRasterizer;
+    /// True if the map layers are painted with the cached background.
+    bool _backgroundCache;
+    /// The paint time decimation tolerance of the layers, in pixels.
+    double _decimationPixels;
+    /// True if the layers are drawn from display lists.
+    bool _displayLists;
+    /// The display list of each layer that has one, by feature index.
+    std::map<int, DisplayListItem*> _displayListItems;
+    /// True if the quality is lowered during interaction.
+    bool _interactiveQuality;
+    /// What is hidden during interaction, from INTERACTIVE_HIDE.
+    int _interactiveHide;
+    /// True while the quality is lowered.
+    bool _interacting;
+    /// The render hints to restore after interaction.
+    QPainter::RenderHints _fullHints;
+    /// The labels() setting, which endInteraction() restores.
+    bool _labelsShown;
+    /// True if the view has been resized since the idle timer last fired.
+    bool _resizePending;
+    /// The memory allowed for the zoom snapshots. Zero for none.
+    qint64 _zoomFrameBudget;
+    /// The snapshot of each zoom stack entry, bottom first. Null where there is none.
+    std::vector<QPixmap> _zoomFrames;
+    /// The snapshot standing in for the view until finishZoom(). Null for none.
+    QPixmap _zoomFrame;
+    /// True if the frame is stretched while the window is resized.
+    bool _resizePreview;
+    /// The frame from before the resize, stretched over the viewport until
+    /// the idle timer fires. Null for none.
+    QPixmap _resizeFrame;
+    /// The last frame painted at full quality, without the annotations, which
+    /// the zoom snapshots and the resize preview are taken from. Null when the
+    /// map has changed since.
+    QPixmap _lastFrame;
+    /// The part of the scene that _lastFrame shows.
+    QRectF _lastFrameRect;
+    /// True while captureFrame() renders, so that the annotations are left out.
+    bool _capturing;
+    /// The parts waiting for redraw(), from DIRTY.
+    int _dirty;
+    /// The beginUpdate() nesting depth.
+    int _updateDepth;
+    /// True if a call of redrawSlot() has been queued.
+    bool _redrawPosted;
 };
 
 #endif /* QMICROMAP_H_ */
@@ -0,0 +1,395 @@
+/*
+ * QMicroMapLoader.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "QMicroMapLoader.h"
+#include "QMicroMap.h"
+#include "LayerItem.h"
+#include <QtCore/QMutexLocker>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+#include <iostream>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+LayerRequest::LayerRequest(int index, Feature* feature, std::string table,
+		double xmin, double ymin, double xmax, double ymax, qint64 page):
+	_index(index),
+	_feature(feature),
+	_table(table),
+	_xmin(xmin),
+	_ymin(ymin),
+	_xmax(xmax),
+	_ymax(ymax),
+	_page(page) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+LayerRequest::~LayerRequest() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Run QMicroMapLoader::loadOne() for one request on the thread pool.
+class QMicroMapLoader::LayerTask: public QRunnable {
+public:
+	LayerTask(QMicroMapLoader* loader, int n):
+		_loader(loader), _n(n) {
+	}
+	virtual void run() {
+		_loader->loadOne(_n);
+	}
+protected:
+	QMicroMapLoader* _loader;
+	int _n;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Build a MapLayer from the geometry streamed by SpatiaLiteConnection::queryGeometry().
+class LayerBuilder: public GeometryVisitor {
+public:
+	LayerBuilder(const LayerRequest& request, MapLayer& layer):
+		_request(request), _layer(layer) {
+	}
+	virtual void point(double x, double y, const char* label) {
+		// Pages share their edges, so a point on the boundary belongs to
+		// the page on its low side only. Otherwise it would be drawn twice.
+		if (_request._page >= 0 && (x >= _request._xmax || y >= _request._ymax)) {
+			return;
+		}
+		_layer._points.append(QPointF(x, y));
+		_layer._labels.append(QString::fromUtf8(label));
+	}
+	virtual void linestring(const double* coords, int n, int stride) {
+		if (n < 2) {
+			return;
+		}
+		if (_request._page >= 0) {
+			copy(coords, n, stride, false);
+			clipPaths(_layer._paths);
+			return;
+		}
+		QPainterPath path;
+		path.moveTo(coords[0], coords[1]);
+		for (int i = 1; i < n; i++) {
+			path.lineTo(coords[i*stride], coords[i*stride+1]);
+		}
+		_layer._paths.append(path);
+	}
+	virtual void polygon(const double* coords, int n, int stride) {
+		if (_request._page >= 0) {
+			// The fill is clipped to the page, which gives it edges along the
+			// page boundary, so the ring is clipped separately as the outline.
+			copy(coords, n, stride, true);
+			_clipped.clear();
+			LayerItem::clipPolygon(_vertices.constData(), _vertices.size(), pageRect(),
+					_clipped, _scratch);
+			if (_clipped.size() >= 3) {
+				// a copy of its own size, since _clipped is also working space
+				_layer._polygons.append(QPolygonF(_clipped));
+				_layer._polygons.last().squeeze();
+			}
+			clipPaths(_layer._outlines);
+			return;
+		}
+		QPolygonF poly(n);
+		for (int i = 0; i < n; i++) {
+			poly[i] = QPointF(coords[i*stride], coords[i*stride+1]);
+		}
+		_layer._polygons.append(poly);
+	}
+protected:
+	// Geometry which crosses a page edge is returned for every page that it
+	// touches, so it is clipped to the page. Otherwise it would be held and
+	// drawn once per page.
+	QRectF pageRect() const {
+		return QRectF(_request._xmin, _request._ymin,
+				_request._xmax - _request._xmin, _request._ymax - _request._ymin);
+	}
+	// Copy the coordinates to _vertices, closing the ring if asked.
+	void copy(const double* coords, int n, int stride, bool close) {
+		_vertices.resize(n);
+		for (int i = 0; i < n; i++) {
+			_vertices[i] = QPointF(coords[i*stride], coords[i*stride+1]);
+		}
+		if (close && n > 0 && _vertices.first() != _vertices.last()) {
+			_vertices.append(_vertices.first());
+		}
+	}
+	// Clip _vertices to the page as a linestring, appending the pieces to paths.
+	void clipPaths(QVector<QPainterPath>& paths) {
+		_clipped.clear();
+		_starts.clear();
+		LayerItem::clipPolyline(_vertices.constData(), _vertices.size(), pageRect(),
+				_clipped, _starts);
+		_starts.append(_clipped.size());
+		for (int p = 0; p + 1 < _starts.size(); p++) {
+			QPainterPath path;
+			path.moveTo(_clipped[_starts[p]]);
+			for (unsigned int i = _starts[p] + 1; i < _starts[p+1]; i++) {
+				path.lineTo(_clipped[i]);
+			}
+			paths.append(path);
+		}
+	}
+	const LayerRequest& _request;
+	MapLayer& _layer;
+	// working space for clipping
+	QVector<QPointF> _vertices;
+	QVector<QPointF> _clipped;
+	QVector<QPointF> _scratch;
+	QVector<quint32> _starts;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QMicroMapLoader::QMicroMapLoader(std::string dbPath,
+		std::vector<LayerRequest> requests,
+		int threads,
+		QObject* parent):
+	QObject(parent),
+	_requests(requests),
+	_layers(requests.size(), 0),
+	_failed(requests.size(), false),
+	_pending(0),
+	_cancel(0),
+	_dbPool(new SpatiaLiteDBPool(dbPath, threads > 0 ? threads : defaultThreads(requests.size()))),
+	_threadPool(new QThreadPool),
+	_ownPools(true) {
+
+	_threadPool->setMaxThreadCount(_dbPool->size());
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QMicroMapLoader::QMicroMapLoader(SpatiaLiteDBPool& dbPool,
+		QThreadPool& threadPool,
+		std::vector<LayerRequest> requests,
+		QObject* parent):
+	QObject(parent),
+	_requests(requests),
+	_layers(requests.size(), 0),
+	_failed(requests.size(), false),
+	_pending(0),
+	_cancel(0),
+	_dbPool(&dbPool),
+	_threadPool(&threadPool),
+	_ownPools(false) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QMicroMapLoader::~QMicroMapLoader() {
+	cancel();
+	wait();
+	for (unsigned int i = 0; i < _layers.size(); i++) {
+		delete _layers[i];
+	}
+	if (_ownPools) {
+		// the threads hold connections until they are done
+		delete _threadPool;
+		delete _dbPool;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int QMicroMapLoader::defaultThreads(int nRequests) {
+	int threads = QThread::idealThreadCount();
+	if (threads > nRequests) {
+		threads = nRequests;
+	}
+	return threads < 1 ? 1 : threads;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMapLoader::start() {
+	{
+		QMutexLocker locker(&_mutex);
+		_pending += _requests.size();
+	}
+	for (unsigned int i = 0; i < _requests.size(); i++) {
+		_threadPool->start(new LayerTask(this, i));
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMapLoader::wait() {
+
+	// A borrowed thread pool may have outlived other loaders' work, so
+	// only this loader's requests are waited for.
+	QMutexLocker locker(&_mutex);
+	while (_pending > 0) {
+		_done.wait(&_mutex);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMapLoader::cancel() {
+	_cancel.store(1);
+	// stop the queries in progress, rather than waiting for them
+	_dbPool->interrupt();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int QMicroMapLoader::size() const {
+	return _requests.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+const LayerRequest& QMicroMapLoader::request(int n) const {
+	return _requests[n];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+MapLayer* QMicroMapLoader::takeLayer(int n) {
+
+	QMutexLocker locker(&_mutex);
+
+	if (n < 0 || n >= (int)_layers.size()) {
+		return 0;
+	}
+
+	MapLayer* layer = _layers[n];
+	_layers[n] = 0;
+	return layer;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMapLoader::failed(int n) {
+
+	QMutexLocker locker(&_mutex);
+
+	if (n < 0 || n >= (int)_failed.size()) {
+		return false;
+	}
+	return _failed[n];
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMapLoader::loadOne(int n) {
+
+	if (_cancel.load()) {
+		finishOne();
+		return;
+	}
+
+	MapLayer* layer = new MapLayer(_requests[n]._index, _requests[n]._page);
+	bool failed = false;
+
+	// A private connection; sqlite handles must not be shared between threads.
+	SpatiaLiteConnection* db = 0;
+	try {
+		db = _dbPool->acquire();
+		// acquire() resumes the connection, which may be after cancel()
+		if (!_cancel.load()) {
+			loadLayer(*db, _requests[n], *layer);
+		}
+	} catch (std::runtime_error& error) {
+		// Deliver the empty layer, so that the ones behind it are not held up.
+		// The queries interrupted by cancel() are expected to fail.
+		failed = true;
+		if (!_cancel.load()) {
+			std::cerr << error.what() << std::endl;
+		}
+	}
+	_dbPool->release(db);
+
+	{
+		QMutexLocker locker(&_mutex);
+		_layers[n] = layer;
+		_failed[n] = failed;
+	}
+	emit layerLoaded(n);
+	finishOne();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMapLoader::finishOne() {
+
+	QMutexLocker locker(&_mutex);
+	if (--_pending == 0) {
+		_done.wakeAll();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMapLoader::loadLayer(SpatiaLiteConnection& db, const LayerRequest& request, MapLayer& layer) {
+
+	Feature* feature = request._feature;
+	layer._table = request._table;
+	layer._geometryColumn = feature->_geometryName;
+	layer._nameColumn = feature->_nameColumn;
+
+	LayerBuilder builder(request, layer);
+
+	try {
+		db.queryGeometry(
+				request._table,
+				feature->_geometryName,
+				request._xmin, request._ymin, request._xmax, request._ymax,
+				feature->_nameColumn,
+				builder);
+	} catch (std::runtime_error& error) {
+		// nothing is kept from a partial result
+		layer._points.clear();
+		layer._labels.clear();
+		layer._polygons.clear();
+		layer._paths.clear();
+		layer._outlines.clear();
+		throw;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMapLoader::copyLayer(SpatiaLiteDB& db, const LayerRequest& request, MapLayer& layer) {
+
+	Feature* feature = request._feature;
+	layer._table = request._table;
+	layer._geometryColumn = feature->_geometryName;
+	layer._nameColumn = feature->_nameColumn;
+
+	// query the table
+	try {
+		db.queryGeometry(
+				request._table,
+				feature->_geometryName,
+				request._xmin, request._ymin, request._xmax, request._ymax,
+				feature->_nameColumn);
+	} catch (std::runtime_error& error) {
+		std::cerr << error.what() << std::endl;
+		return;
+	}
+
+	SpatiaLiteDB::PointList points = db.points();
+	SpatiaLiteDB::LinestringList linestrings = db.linestrings();
+	SpatiaLiteDB::PolygonList polygons = db.polygons();
+
+	for (unsigned int i = 0; i < points.size(); i++) {
+		// Pages share their edges, so a point on the boundary belongs to
+		// the page on its low side only. Otherwise it would be drawn twice.
+		if (request._page >= 0 &&
+				(points[i]._x >= request._xmax || points[i]._y >= request._ymax)) {
+			continue;
+		}
+		layer._points.append(QPointF(points[i]._x, points[i]._y));
+		layer._labels.append(QString(points[i]._label.c_str()));
+	}
+
+	for (unsigned int i = 0; i < polygons.size(); i++) {
+		SpatiaLiteDB::Ring extRing = polygons[i].extRing();
+		QPolygonF poly;
+		for (unsigned int j = 0; j < extRing.size(); j++) {
+			poly << QPointF(extRing[j]._x, extRing[j]._y);
+		}
+		layer._polygons.append(poly);
+	}
+
+	for (unsigned int i = 0; i < linestrings.size(); i++) {
+		SpatiaLiteDB::Linestring& ls = linestrings[i];
+		if (ls.size() < 2) {
+			continue;
+		}
+		QPainterPath path;
+		path.moveTo(ls[0]._x, ls[0]._y);
+		for (unsigned int j = 1; j < ls.size(); j++) {
+			path.lineTo(ls[j]._x, ls[j]._y);
+		}
+		layer._paths.append(path);
+	}
+}
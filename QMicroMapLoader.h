@@ -0,0 +1,190 @@
+/*
+ * QMicroMapLoader.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef QMICROMAPLOADER_H_
+#define QMICROMAPLOADER_H_
+
+#include <QtCore/QObject>
+#include <QtCore/QThreadPool>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QAtomicInt>
+#include <vector>
+#include <string>
+#include "SpatialDB/SpatiaLiteDB.h"
+#include "SpatiaLiteDBPool.h"
+#include "MapLayer.h"
+
+class Feature;
+
+/////////////////////////////////////////////////////////////////////
+/// @brief One unit of work for QMicroMapLoader: a feature, the table to
+/// read it from, and the bounding box of the query.
+///
+/// The table is normally the feature's own table, but may be one of its
+/// simplified level of detail copies.
+class LayerRequest {
+public:
+	/// Constructor
+	/// @param index The position of the feature in QMicroMap::_features.
+	/// @param feature The feature to extract.
+	/// @param table The table to query.
+	/// @param xmin The bounding box minimum longitude, in decimal degrees.
+	/// @param ymin The bounding box minimum latitude, in decimal degrees.
+	/// @param xmax The bounding box maximum longitude, in decimal degrees.
+	/// @param ymax The bounding box maximum latitude, in decimal degrees.
+	/// @param page The map page covered by the bounding box, when the
+	/// map is paged. -1 for the whole map.
+	LayerRequest(int index, Feature* feature, std::string table,
+			double xmin, double ymin, double xmax, double ymax,
+			qint64 page = -1);
+	/// Destructor
+	virtual ~LayerRequest();
+	/// The position of the feature in QMicroMap::_features.
+	int _index;
+	/// The feature to extract.
+	Feature* _feature;
+	/// The table to query.
+	std::string _table;
+	/// Minimum longitude of the query.
+	double _xmin;
+	/// Minimum latitude of the query.
+	double _ymin;
+	/// Maximum longitude of the query.
+	double _xmax;
+	/// Maximum latitude of the query.
+	double _ymax;
+	/// The map page, or -1 for the whole map.
+	qint64 _page;
+};
+
+/////////////////////////////////////////////////////////////////////
+/// @brief Extract map features from the database in worker threads.
+///
+/// Each LayerRequest is an independent query, so the loader runs one task
+/// per request on a QThreadPool. The tasks borrow connections
+/// from a SpatiaLiteDBPool opened on the same database; the
+/// SpatiaLiteDB owned by the application is never touched from another
+/// thread. The pools may be private to the loader, or borrowed, so that a
+/// long lived owner such as QMicroMap keeps its threads and open
+/// connections from one load to the next. Each task queries its table and converts the geometry to a
+/// MapLayer. The layerLoaded() signal is emitted as each one is
+/// completed, in whatever order they finish; the receiver collects
+/// the layer with takeLayer(). Layers are identified by the position of
+/// their request in the request list.
+///
+/// The features are only read by the loader. They must not be
+/// modified or deleted until the loader has finished, or has been
+/// cancelled and waited for.
+class QMicroMapLoader: public QObject {
+	Q_OBJECT
+
+public:
+	/// Constructor
+	/// @param dbPath Path to the geographic database.
+	/// @param requests The layers to be extracted.
+	/// @param threads The number of worker threads, and database connections.
+	/// Zero selects defaultThreads().
+	/// @param parent The parent object.
+	QMicroMapLoader(std::string dbPath,
+			std::vector<LayerRequest> requests,
+			int threads = 0,
+			QObject* parent = 0);
+	/// Constructor, for a loader which borrows its pools. They must outlive
+	/// the loader, and are used by one loader at a time.
+	/// @param dbPool The database connections.
+	/// @param threadPool The worker threads. No more than dbPool.size() are
+	/// useful.
+	/// @param requests The layers to be extracted.
+	/// @param parent The parent object.
+	QMicroMapLoader(SpatiaLiteDBPool& dbPool,
+			QThreadPool& threadPool,
+			std::vector<LayerRequest> requests,
+			QObject* parent = 0);
+	/// Destructor. Outstanding work is cancelled and waited for, and
+	/// any layers which were not taken are deleted.
+	virtual ~QMicroMapLoader();
+	/// Queue all of the requests for loading.
+	void start();
+	/// Block until all queued requests have been loaded, or skipped
+	/// because of cancel().
+	void wait();
+	/// @return The number of requests.
+	int size() const;
+	/// @return A request.
+	/// @param n The position of the request in the request list.
+	const LayerRequest& request(int n) const;
+	/// Collect a completed layer.
+	/// @param n The position of the request in the request list.
+	/// @return The layer, or 0 if it has not been loaded yet. The caller
+	/// takes ownership.
+	MapLayer* takeLayer(int n);
+	/// @return True if the query for a layer failed. The layer is then
+	/// empty, and should not be drawn or cached.
+	/// @param n The position of the request in the request list.
+	bool failed(int n);
+	/// Ask the workers to skip the requests that have not been started,
+	/// and interrupt the queries that are running, which leave their layers
+	/// empty. Follow with wait() if the features are about to be deleted.
+	void cancel();
+	/// @return The number of worker threads used for nRequests requests:
+	/// one per request, but no more than the number of cores.
+	/// @param nRequests The number of requests to be loaded.
+	static int defaultThreads(int nRequests);
+	/// Query one feature and convert the results into a MapLayer.
+	/// Each geometry is streamed from the query straight into the layer,
+	/// without intermediate containers. For a paged request, points on the
+	/// high edges of the bounding box are left to the neighbouring page.
+	/// @param db The database to query.
+	/// @param request The feature, table and bounding box.
+	/// @param layer The converted geometry is returned here. It is left
+	/// empty if the query fails.
+	/// @throws std::runtime_error on a query error.
+	static void loadLayer(SpatiaLiteConnection& db, const LayerRequest& request, MapLayer& layer);
+	/// The same as loadLayer(), but through the point, linestring and
+	/// polygon lists of SpatiaLiteDB, which copy every vertex before it
+	/// reaches the layer. Kept for comparison by mapbench.
+	/// @param db The database to query.
+	/// @param request The feature, table and bounding box.
+	/// @param layer The converted geometry is returned here.
+	static void copyLayer(SpatiaLiteDB& db, const LayerRequest& request, MapLayer& layer);
+
+signals:
+	/// Emitted from a worker thread when a layer is ready to be taken.
+	/// @param n The position of the request in the request list.
+	void layerLoaded(int n);
+
+protected:
+	/// The task which loads a single request.
+	class LayerTask;
+	/// Load one request, using a pooled connection. Called by the worker threads.
+	/// @param n The position of the request in the request list.
+	void loadOne(int n);
+	/// Count a request as finished, and wake wait() after the last one.
+	void finishOne();
+	/// The layers to be extracted.
+	std::vector<LayerRequest> _requests;
+	/// Completed layers, indexed like _requests. 0 until loaded or after taken.
+	std::vector<MapLayer*> _layers;
+	/// True for the layers whose query failed, indexed like _requests.
+	std::vector<bool> _failed;
+	/// Protects _layers, _failed and _pending.
+	QMutex _mutex;
+	/// Signalled when _pending reaches zero.
+	QWaitCondition _done;
+	/// The number of queued requests which have not finished.
+	int _pending;
+	/// Non-zero when the workers have been asked to stop.
+	QAtomicInt _cancel;
+	/// The reader connections shared by the workers.
+	SpatiaLiteDBPool* _dbPool;
+	/// The worker threads.
+	QThreadPool* _threadPool;
+	/// True if the pools were created by the loader, and are deleted with it.
+	bool _ownPools;
+};
+
+#endif /* QMICROMAPLOADER_H_ */
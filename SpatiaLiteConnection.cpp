@@ -0,0 +1,295 @@
+/*
+ * SpatiaLiteConnection.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "SpatiaLiteConnection.h"
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <stdexcept>
+#include <stdlib.h>
+
+#include <spatialite/sqlite3.h>
+#include <spatialite/gaiageo.h>
+#include <spatialite.h>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+GeometryVisitor::~GeometryVisitor() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @return The number of doubles per vertex for a gaia dimension model.
+static int stride(int dimensionModel) {
+	switch (dimensionModel) {
+	case GAIA_XY_Z:
+	case GAIA_XY_M:
+		return 3;
+	case GAIA_XY_Z_M:
+		return 4;
+	default:
+		return 2;
+	}
+}
+
+/// Guards the one time registration of the SpatiaLite extension.
+static QMutex initMutex;
+/// True once the extension has been registered.
+static bool initialized = false;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Register the SpatiaLite extension with sqlite, the first time it is called.
+/// spatialite_init() is not thread safe, and the pool opens connections
+/// from its worker threads.
+static void initSpatiaLite() {
+	QMutexLocker locker(&initMutex);
+	if (!initialized) {
+		spatialite_init(0);
+		initialized = true;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+SpatiaLiteConnection::SpatiaLiteConnection(std::string dbPath, bool readOnly):
+	_dbPath(dbPath),
+	_handle(0),
+	_interrupted(0) {
+
+	// The extension must be registered before the connection is opened.
+	initSpatiaLite();
+
+	int flags = readOnly ? SQLITE_OPEN_READONLY : SQLITE_OPEN_READWRITE;
+	int ret = sqlite3_open_v2(_dbPath.c_str(), &_handle, flags, NULL);
+	if (ret != SQLITE_OK) {
+		std::string msg = _dbPath + ": " + sqlite3_errmsg(_handle);
+		sqlite3_close(_handle);
+		_handle = 0;
+		throw std::runtime_error(msg);
+	}
+
+	// Unlike sqlite3_interrupt(), the handler also catches a statement
+	// which is started just after interrupt().
+	sqlite3_progress_handler(_handle, 1000, progress, this);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+SpatiaLiteConnection::~SpatiaLiteConnection() {
+	if (_handle) {
+		sqlite3_close(_handle);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::vector<SpatiaLiteConnection::Row> SpatiaLiteConnection::query(const std::string& sql) {
+
+	char** results;
+	int n_rows;
+	int n_columns;
+	char* err_msg = NULL;
+
+	int ret = sqlite3_get_table(_handle, sql.c_str(), &results, &n_rows, &n_columns, &err_msg);
+	if (ret != SQLITE_OK) {
+		std::string msg = error(err_msg, sql);
+		sqlite3_free(err_msg);
+		throw std::runtime_error(msg);
+	}
+
+	// the first row of results holds the column names
+	std::vector<Row> rows(n_rows);
+	for (int i = 1; i <= n_rows; i++) {
+		for (int j = 0; j < n_columns; j++) {
+			const char* value = results[(i * n_columns) + j];
+			rows[i-1].push_back(value ? value : "");
+		}
+	}
+	sqlite3_free_table(results);
+
+	return rows;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void SpatiaLiteConnection::exec(const std::string& sql) {
+
+	char* err_msg = NULL;
+
+	int ret = sqlite3_exec(_handle, sql.c_str(), NULL, NULL, &err_msg);
+	if (ret != SQLITE_OK) {
+		std::string msg = error(err_msg, sql);
+		sqlite3_free(err_msg);
+		throw std::runtime_error(msg);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void SpatiaLiteConnection::queryGeometry(const std::string& table, const std::string& geometryColumn,
+		double xmin, double ymin, double xmax, double ymax,
+		const std::string& nameColumn, GeometryVisitor& visitor) {
+
+	std::string sql = geometryQuery(table, geometryColumn, nameColumn);
+
+	sqlite3_stmt* stmt = 0;
+	if (sqlite3_prepare_v2(_handle, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+		throw std::runtime_error(error(0, sql));
+	}
+	sqlite3_bind_double(stmt, 1, xmin);
+	sqlite3_bind_double(stmt, 2, ymin);
+	sqlite3_bind_double(stmt, 3, xmax);
+	sqlite3_bind_double(stmt, 4, ymax);
+
+	int ret;
+	while ((ret = sqlite3_step(stmt)) == SQLITE_ROW) {
+
+		const unsigned char* blob = (const unsigned char*) sqlite3_column_blob(stmt, 0);
+		int blobSize = sqlite3_column_bytes(stmt, 0);
+		if (!blob || blobSize == 0) {
+			continue;
+		}
+
+		gaiaGeomCollPtr geom = gaiaFromSpatiaLiteBlobWkb(blob, blobSize);
+		if (!geom) {
+			continue;
+		}
+
+		const char* label = "";
+		if (nameColumn.size() && sqlite3_column_type(stmt, 1) != SQLITE_NULL) {
+			label = (const char*) sqlite3_column_text(stmt, 1);
+		}
+
+		for (gaiaPointPtr pt = geom->FirstPoint; pt; pt = pt->Next) {
+			visitor.point(pt->X, pt->Y, label);
+		}
+		for (gaiaLinestringPtr ls = geom->FirstLinestring; ls; ls = ls->Next) {
+			visitor.linestring(ls->Coords, ls->Points, stride(ls->DimensionModel));
+		}
+		for (gaiaPolygonPtr pg = geom->FirstPolygon; pg; pg = pg->Next) {
+			gaiaRingPtr ring = pg->Exterior;
+			visitor.polygon(ring->Coords, ring->Points, stride(ring->DimensionModel));
+		}
+
+		gaiaFreeGeomColl(geom);
+	}
+
+	if (ret != SQLITE_DONE) {
+		std::string msg = error(0, sql);
+		sqlite3_finalize(stmt);
+		throw std::runtime_error(msg);
+	}
+	sqlite3_finalize(stmt);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+SpatiaLiteConnection::SPATIAL_INDEX SpatiaLiteConnection::spatialIndex(const std::string& table,
+		const std::string& geometryColumn) {
+
+	std::string key = table + "." + geometryColumn;
+	std::map<std::string, SPATIAL_INDEX>::iterator i = _spatialIndexes.find(key);
+	if (i != _spatialIndexes.end()) {
+		return i->second;
+	}
+
+	SPATIAL_INDEX index = INDEX_NONE;
+
+	std::vector<Row> enabled = query(
+			"SELECT spatial_index_enabled FROM geometry_columns WHERE lower(f_table_name) = lower("
+			+ quote(table) + ") AND lower(f_geometry_column) = lower(" + quote(geometryColumn) + ")");
+
+	if (enabled.size()) {
+		// make sure that the index table is really there
+		int kind = atoi(enabled[0][0].c_str());
+		std::string indexTable;
+		if (kind == INDEX_RTREE) {
+			indexTable = "idx_" + table + "_" + geometryColumn;
+		} else if (kind == INDEX_MBRCACHE) {
+			indexTable = "cache_" + table + "_" + geometryColumn;
+		}
+		if (indexTable.size() && query(
+				"SELECT name FROM sqlite_master WHERE lower(name) = lower(" + quote(indexTable) + ")").size()) {
+			index = (SPATIAL_INDEX)kind;
+		}
+	}
+
+	_spatialIndexes[key] = index;
+	return index;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string SpatiaLiteConnection::geometryQuery(const std::string& table, const std::string& geometryColumn,
+		const std::string& nameColumn) {
+
+	std::string sql = "SELECT \"" + geometryColumn + "\"";
+	if (nameColumn.size()) {
+		sql += ", \"" + nameColumn + "\"";
+	}
+	sql += " FROM \"" + table + "\" WHERE ";
+
+	switch (spatialIndex(table, geometryColumn)) {
+	case INDEX_RTREE:
+		// the R*Tree holds each geometry's MBR, so its answer is exact
+		sql += "ROWID IN (SELECT pkid FROM \"idx_" + table + "_" + geometryColumn + "\""
+				" WHERE xmin <= ?3 AND xmax >= ?1 AND ymin <= ?4 AND ymax >= ?2)";
+		break;
+	case INDEX_MBRCACHE:
+		sql += "ROWID IN (SELECT rowid FROM \"cache_" + table + "_" + geometryColumn + "\""
+				" WHERE mbr = FilterMbrIntersects(?1, ?2, ?3, ?4))";
+		break;
+	default:
+		sql += "MbrIntersects(\"" + geometryColumn + "\", BuildMbr(?1, ?2, ?3, ?4))";
+		break;
+	}
+
+	return sql;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::vector<std::string> SpatiaLiteConnection::queryPlan(const std::string& sql) {
+
+	std::vector<std::string> plan;
+
+	// unbound parameters are NULL, which does not change the plan
+	std::vector<Row> rows = query("EXPLAIN QUERY PLAN " + sql);
+	for (unsigned int i = 0; i < rows.size(); i++) {
+		// the layout varies between sqlite versions, but the detail is always last
+		if (rows[i].size()) {
+			plan.push_back(rows[i].back());
+		}
+	}
+	return plan;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string SpatiaLiteConnection::error(const char* msg, const std::string& sql) {
+	return _dbPath + ": " + (msg ? msg : sqlite3_errmsg(_handle)) + " (" + sql + ")";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string SpatiaLiteConnection::dbPath() const {
+	return _dbPath;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void SpatiaLiteConnection::interrupt() {
+	_interrupted.store(1);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void SpatiaLiteConnection::resume() {
+	_interrupted.store(0);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int SpatiaLiteConnection::progress(void* connection) {
+	return ((SpatiaLiteConnection*)connection)->_interrupted.load();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string SpatiaLiteConnection::quote(const std::string& s) {
+
+	std::string result("'");
+	for (unsigned int i = 0; i < s.size(); i++) {
+		if (s[i] == '\'') {
+			result += '\'';
+		}
+		result += s[i];
+	}
+	result += "'";
+	return result;
+}
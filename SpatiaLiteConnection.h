@@ -0,0 +1,163 @@
+/*
+ * SpatiaLiteConnection.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SPATIALITECONNECTION_H_
+#define SPATIALITECONNECTION_H_
+
+#include <QtCore/QAtomicInt>
+#include <vector>
+#include <map>
+#include <string>
+
+struct sqlite3;
+
+/////////////////////////////////////////////////////////////////////
+/// @brief Receives the geometry of SpatiaLiteConnection::queryGeometry(),
+/// one element at a time, as it is decoded.
+///
+/// The coordinates belong to the decoded row, and are only valid during
+/// the call. Each vertex occupies stride doubles, of which the first
+/// two are x and y.
+class GeometryVisitor {
+public:
+	/// Destructor
+	virtual ~GeometryVisitor();
+	/// A point.
+	/// @param x The longitude.
+	/// @param y The latitude.
+	/// @param label The contents of the name column. Empty if none.
+	virtual void point(double x, double y, const char* label) = 0;
+	/// A linestring.
+	/// @param coords The vertices.
+	/// @param n The number of vertices.
+	/// @param stride The number of doubles per vertex.
+	virtual void linestring(const double* coords, int n, int stride) = 0;
+	/// The exterior ring of a polygon.
+	/// @param coords The vertices.
+	/// @param n The number of vertices.
+	/// @param stride The number of doubles per vertex.
+	virtual void polygon(const double* coords, int n, int stride) = 0;
+};
+
+/////////////////////////////////////////////////////////////////////
+/// @brief A direct connection to a SpatiaLite database, for the
+/// housekeeping that QMicroMap needs beyond SpatiaLiteDB.
+///
+/// The connection is opened with the SpatiaLite extension loaded, so
+/// that the spatial SQL functions are available. Like any sqlite
+/// handle, it must only be used by one thread at a time.
+///
+/// Errors are reported by throwing std::runtime_error.
+class SpatiaLiteConnection {
+public:
+	/// A result row; every column is returned as text. SQL NULL
+	/// values are returned as empty strings.
+	typedef std::vector<std::string> Row;
+	/// The kinds of spatial index, numbered as in geometry_columns.spatial_index_enabled.
+	enum SPATIAL_INDEX {
+		/// No index; a bounding box query scans the whole table.
+		INDEX_NONE = 0,
+		/// An R*Tree, in the virtual table idx_<table>_<column>.
+		INDEX_RTREE = 1,
+		/// An MBR cache, in the virtual table cache_<table>_<column>.
+		INDEX_MBRCACHE = 2
+	};
+	/// Constructor
+	/// @param dbPath Path to the database.
+	/// @param readOnly Open the database read only.
+	/// @throws std::runtime_error if the database cannot be opened.
+	SpatiaLiteConnection(std::string dbPath, bool readOnly = true);
+	/// Destructor
+	virtual ~SpatiaLiteConnection();
+	/// Run an SQL query and collect the results.
+	/// @param sql The SQL statement.
+	/// @return The result rows.
+	/// @throws std::runtime_error on an SQL error.
+	std::vector<Row> query(const std::string& sql);
+	/// Execute SQL statements that return no results.
+	/// @param sql The SQL statements.
+	/// @throws std::runtime_error on an SQL error.
+	void exec(const std::string& sql);
+	/// Find the geometries which intersect a bounding box, and pass each one
+	/// to a visitor as soon as it has been decoded. Nothing is accumulated;
+	/// the only allocation is for the decoded geometry of the current row.
+	/// Multi geometries are visited element by element. The query goes
+	/// through the spatial index of the column, if it has one; see geometryQuery().
+	/// @param table The table.
+	/// @param geometryColumn The geometry column.
+	/// @param xmin The bounding box minimum longitude, in decimal degrees.
+	/// @param ymin The bounding box minimum latitude, in decimal degrees.
+	/// @param xmax The bounding box maximum longitude, in decimal degrees.
+	/// @param ymax The bounding box maximum latitude, in decimal degrees.
+	/// @param nameColumn The column holding the point labels. Blank if none.
+	/// @param visitor Receives the geometry.
+	/// @throws std::runtime_error on an SQL error.
+	void queryGeometry(const std::string& table, const std::string& geometryColumn,
+			double xmin, double ymin, double xmax, double ymax,
+			const std::string& nameColumn, GeometryVisitor& visitor);
+	/// @return The spatial index of a geometry column. The result is remembered
+	/// for the life of the connection.
+	/// @param table The table.
+	/// @param geometryColumn The geometry column.
+	/// @throws std::runtime_error on an SQL error.
+	SPATIAL_INDEX spatialIndex(const std::string& table, const std::string& geometryColumn);
+	/// Build the SQL used by queryGeometry(). The bounding box is given by the
+	/// parameters ?1 to ?4 (xmin, ymin, xmax, ymax). An R*Tree is searched
+	/// directly for the row ids; an MBR cache is filtered with FilterMbrIntersects();
+	/// without an index the MbrIntersects() test is applied to every row.
+	/// @param table The table.
+	/// @param geometryColumn The geometry column.
+	/// @param nameColumn The column holding the point labels. Blank if none.
+	/// @return The SQL.
+	/// @throws std::runtime_error on an SQL error.
+	std::string geometryQuery(const std::string& table, const std::string& geometryColumn,
+			const std::string& nameColumn);
+	/// Ask sqlite how it would execute a statement.
+	/// @param sql The statement.
+	/// @return The detail column of EXPLAIN QUERY PLAN, one entry per step.
+	/// @throws std::runtime_error on an SQL error.
+	std::vector<std::string> queryPlan(const std::string& sql);
+	/// @return The path to the database.
+	std::string dbPath() const;
+	/// Abandon the statement that is running, and any that are started
+	/// later, until resume() is called. They fail with an "interrupted"
+	/// error. This is the one method which may be called from another
+	/// thread while the connection is in use.
+	void interrupt();
+	/// Allow statements to run again after interrupt().
+	void resume();
+	/// Quote a string as an SQL literal.
+	/// @param s The string.
+	/// @return s in single quotes, with embedded quotes doubled.
+	static std::string quote(const std::string& s);
+
+protected:
+	/// Path to the database.
+	std::string _dbPath;
+	/// The sqlite handle.
+	sqlite3* _handle;
+	/// The spatial index of each table.column that has been asked about.
+	std::map<std::string, SPATIAL_INDEX> _spatialIndexes;
+	/// Non-zero after interrupt(), until resume().
+	QAtomicInt _interrupted;
+	/// The sqlite progress handler, which stops a statement after interrupt().
+	/// @param connection The SpatiaLiteConnection.
+	/// @return Non-zero to stop the statement.
+	static int progress(void* connection);
+	/// Build an error message.
+	/// @param msg The sqlite error message. If null, the connection's last error is used.
+	/// @param sql The statement that failed.
+	/// @return The message.
+	std::string error(const char* msg, const std::string& sql);
+
+private:
+	/// Not copyable.
+	SpatiaLiteConnection(const SpatiaLiteConnection&);
+	/// Not assignable.
+	SpatiaLiteConnection& operator=(const SpatiaLiteConnection&);
+};
+
+#endif /* SPATIALITECONNECTION_H_ */
@@ -0,0 +1,90 @@
+/*
+ * SpatiaLiteDBPool.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "SpatiaLiteDBPool.h"
+#include <QtCore/QMutexLocker>
+#include <stdexcept>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+SpatiaLiteDBPool::SpatiaLiteDBPool(std::string dbPath, int size):
+	_dbPath(dbPath),
+	_size(size < 1 ? 1 : size),
+	_opened(0) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+SpatiaLiteDBPool::~SpatiaLiteDBPool() {
+	for (unsigned int i = 0; i < _all.size(); i++) {
+		delete _all[i];
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+SpatiaLiteConnection* SpatiaLiteDBPool::acquire() {
+
+	QMutexLocker locker(&_mutex);
+
+	while (_idle.empty() && _opened >= _size) {
+		_released.wait(&_mutex);
+	}
+
+	if (!_idle.empty()) {
+		SpatiaLiteConnection* db = _idle.back();
+		_idle.pop_back();
+		db->resume();
+		return db;
+	}
+
+	// Claim a slot, and open the connection without holding the lock,
+	// so that other workers are not held up while the file is opened.
+	_opened++;
+	locker.unlock();
+
+	SpatiaLiteConnection* db = 0;
+	try {
+		db = new SpatiaLiteConnection(_dbPath);
+	} catch (...) {
+		locker.relock();
+		_opened--;
+		_released.wakeOne();
+		throw std::runtime_error(_dbPath + ": unable to open a pool connection");
+	}
+
+	locker.relock();
+	_all.push_back(db);
+	return db;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void SpatiaLiteDBPool::release(SpatiaLiteConnection* db) {
+
+	if (!db) {
+		return;
+	}
+
+	QMutexLocker locker(&_mutex);
+	_idle.push_back(db);
+	_released.wakeOne();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void SpatiaLiteDBPool::interrupt() {
+
+	// connections are only closed by the destructor, so they are all safe to touch
+	QMutexLocker locker(&_mutex);
+	for (unsigned int i = 0; i < _all.size(); i++) {
+		_all[i]->interrupt();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int SpatiaLiteDBPool::size() const {
+	return _size;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string SpatiaLiteDBPool::dbPath() const {
+	return _dbPath;
+}
@@ -0,0 +1,65 @@
+/*
+ * SpatiaLiteDBPool.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef SPATIALITEDBPOOL_H_
+#define SPATIALITEDBPOOL_H_
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <vector>
+#include <string>
+#include "SpatiaLiteConnection.h"
+
+/////////////////////////////////////////////////////////////////////
+/// @brief A pool of reader connections to one geographic database.
+///
+/// SQLite connections must not be shared between threads, so each
+/// worker borrows a private SpatiaLiteConnection with acquire(), and
+/// gives it back with release(). Connections are opened read only and on
+/// demand, up to the pool size; when they are all in use, acquire()
+/// blocks until one is returned.
+class SpatiaLiteDBPool {
+public:
+	/// Constructor
+	/// @param dbPath Path to the geographic database.
+	/// @param size The maximum number of open connections.
+	SpatiaLiteDBPool(std::string dbPath, int size);
+	/// Destructor. All connections must have been released.
+	virtual ~SpatiaLiteDBPool();
+	/// Borrow a connection, opening a new one if necessary.
+	/// @return The connection. It must be handed back with release().
+	/// @throws std::runtime_error if the database cannot be opened.
+	SpatiaLiteConnection* acquire();
+	/// Return a connection to the pool.
+	/// @param db The connection obtained from acquire().
+	void release(SpatiaLiteConnection* db);
+	/// Interrupt the statements running on every open connection, so
+	/// that the workers finish quickly. Each connection is resumed when it
+	/// is next acquired.
+	void interrupt();
+	/// @return The maximum number of open connections.
+	int size() const;
+	/// @return The path to the database.
+	std::string dbPath() const;
+
+protected:
+	/// Path to the geographic database.
+	std::string _dbPath;
+	/// The maximum number of open connections.
+	int _size;
+	/// The number of connections that have been opened.
+	int _opened;
+	/// Connections that are open and not in use.
+	std::vector<SpatiaLiteConnection*> _idle;
+	/// All open connections.
+	std::vector<SpatiaLiteConnection*> _all;
+	/// Protects the connection lists.
+	QMutex _mutex;
+	/// Signalled when a connection is released.
+	QWaitCondition _released;
+};
+
+#endif /* SPATIALITEDBPOOL_H_ */
@@ -0,0 +1,419 @@
+/*
+ * TilePyramidItem.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "TilePyramidItem.h"
+#include "LayerItem.h"
+#include "TileStore.h"
+#include "TileRasterizer.h"
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QCryptographicHash>
+#include <QtGui/QPainter>
+#include <QtWidgets/QStyleOptionGraphicsItem>
+#include <math.h>
+
+/// The default memory allowed for finished tiles, in kilobytes.
+static const int TILE_CACHE_KB = 64 * 1024;
+
+/// A TileRasterizer for each worker thread, so that its scratch buffers are
+/// reused from tile to tile. It is deleted when the thread finishes.
+static QThreadStorage<TileRasterizer*> rasterizers;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Run TilePyramidItem::renderTile() for one tile on the thread pool.
+class TilePyramidItem::TileTask: public QRunnable {
+public:
+	TileTask(TilePyramidItem* pyramid, qint64 key, int generation,
+			QSharedPointer<const Snapshot> snapshot, QString scene):
+		_pyramid(pyramid), _key(key), _generation(generation), _snapshot(snapshot),
+		_scene(scene) {
+	}
+	virtual void run() {
+		_pyramid->renderTile(_key, _generation, _snapshot, _scene);
+	}
+protected:
+	TilePyramidItem* _pyramid;
+	qint64 _key;
+	int _generation;
+	QSharedPointer<const Snapshot> _snapshot;
+	QString _scene;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+TilePyramidItem::TilePyramidItem(QRectF extent, int threads, QGraphicsItem* parent):
+	QGraphicsObject(parent),
+	_extent(extent.normalized()),
+	_store(0),
+	_rasterizer(false),
+	_generation(0),
+	_paintLevel(-1),
+	_cache(TILE_CACHE_KB) {
+
+	if (threads > 0) {
+		_threadPool.setMaxThreadCount(threads);
+	}
+
+	// the workers hand their tiles over to the GUI thread
+	connect(this, SIGNAL(tileRendered()), this, SLOT(collectTiles()), Qt::QueuedConnection);
+
+	// paint() needs the exposed area
+	setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+TilePyramidItem::~TilePyramidItem() {
+	_threadPool.clear();
+	_threadPool.waitForDone();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TilePyramidItem::setLayer(int index, const QList<QGraphicsItem*>& items,
+		const std::string& source) {
+
+	QList<TileLayer> layers;
+	for (int i = 0; i < items.size(); i++) {
+		LayerItem* item = dynamic_cast<LayerItem*>(items[i]);
+		if (!item) {
+			continue;
+		}
+		TileLayer layer;
+		layer._polygons = item->polygons();
+		layer._pen = item->pen();
+		layer._brush = item->brush();
+		item->copyParts(layer._vertices, layer._partStart, layer._partBoxes);
+		layers.append(layer);
+	}
+
+	if (layers.isEmpty()) {
+		_sources.erase(index);
+		if (_layers.erase(index) == 0) {
+			return;
+		}
+	} else {
+		_layers[index] = layers;
+		_sources[index] = source;
+	}
+
+	invalidate();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TilePyramidItem::removeLayer(int index) {
+
+	_sources.erase(index);
+	if (_layers.erase(index)) {
+		invalidate();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TilePyramidItem::setSource(int index, const std::string& source) {
+
+	if (_layers.find(index) == _layers.end() || _sources[index] == source) {
+		return;
+	}
+	_sources[index] = source;
+	invalidate();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TilePyramidItem::setStore(TileStore* store) {
+
+	if (store != _store) {
+		// let the workers finish with the old one
+		_threadPool.clear();
+		_threadPool.waitForDone();
+		_store = store;
+		invalidate();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TilePyramidItem::setRasterizer(bool on) {
+
+	if (on != _rasterizer) {
+		// the workers read it
+		_threadPool.clear();
+		_threadPool.waitForDone();
+		_rasterizer = on;
+		invalidate();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool TilePyramidItem::rasterizer() const {
+	return _rasterizer;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QString TilePyramidItem::sceneKey() const {
+
+	QByteArray scene;
+	// the two renderers' tiles differ, so they are stored apart
+	if (_rasterizer) {
+		scene += "rasterizer\n";
+	}
+	scene += QString("tile %1 extent %2 %3 %4 %5\n").arg(TILE_PIXELS)
+			.arg(_extent.left(), 0, 'g', 17).arg(_extent.top(), 0, 'g', 17)
+			.arg(_extent.width(), 0, 'g', 17).arg(_extent.height(), 0, 'g', 17).toUtf8();
+
+	for (std::map<int, QList<TileLayer> >::const_iterator i = _layers.begin(); i != _layers.end(); i++) {
+		std::map<int, std::string>::const_iterator source = _sources.find(i->first);
+		if (source == _sources.end() || source->second.empty()) {
+			return "";
+		}
+		scene += QString("layer %1 ").arg(i->first).toUtf8();
+		scene += QByteArray(source->second.c_str());
+		for (int j = 0; j < i->second.size(); j++) {
+			const TileLayer& layer = i->second[j];
+			scene += QString(" %1 %2 %3 %4 %5").arg(layer._polygons)
+					.arg(layer._pen.color().rgba()).arg(layer._pen.widthF())
+					.arg(layer._brush.color().rgba()).arg((int)layer._brush.style()).toUtf8();
+		}
+		scene += "\n";
+	}
+
+	return QCryptographicHash::hash(scene, QCryptographicHash::Sha1).toHex();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TilePyramidItem::setCacheBudget(qint64 bytes) {
+	_cache.setMaxCost(bytes / 1024);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TilePyramidItem::invalidate() {
+
+	_generation.ref();
+	_snapshot.clear();
+	// tiles already being rendered are discarded by collectTiles()
+	_threadPool.clear();
+	_pending.clear();
+	_cache.clear();
+	update();
+	emit tilesUpdated(_extent);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QRectF TilePyramidItem::boundingRect() const {
+	return _extent;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+qint64 TilePyramidItem::tileKey(int level, int col, int row) {
+	return ((qint64)level << 48) | ((qint64)row << 24) | (qint64)col;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+double TilePyramidItem::tileSize(int level) const {
+	return qMax(_extent.width(), _extent.height()) / (1 << level);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QRectF TilePyramidItem::tileRect(qint64 key) const {
+
+	int level = key >> 48;
+	int row = (key >> 24) & 0xffffff;
+	int col = key & 0xffffff;
+
+	double size = tileSize(level);
+	return QRectF(_extent.left() + col * size, _extent.top() + row * size, size, size);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int TilePyramidItem::tileLevel(double devicePixelsPerUnit) const {
+
+	// the tiles of level 0 have this many device pixels for each tile pixel
+	double ratio = tileSize(0) * devicePixelsPerUnit / TILE_PIXELS;
+
+	int level = 0;
+	while (level < MAX_LEVEL && ratio > 1.0) {
+		ratio /= 2.0;
+		level++;
+	}
+	return level;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TilePyramidItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* /*widget*/) {
+
+	QRectF exposed = option->exposedRect & _extent;
+	if (exposed.isEmpty() || _layers.empty()) {
+		return;
+	}
+
+	// the world transform does not include the device pixel ratio
+	double pixels = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+	if (painter->device()) {
+		pixels *= painter->device()->devicePixelRatioF();
+	}
+	int level = tileLevel(pixels);
+
+	if (level != _paintLevel) {
+		// the queued tiles of the old level are no longer wanted
+		_threadPool.clear();
+		_pending.clear();
+		_paintLevel = level;
+	}
+
+	double size = tileSize(level);
+	int col0 = (int)floor((exposed.left() - _extent.left()) / size);
+	int col1 = (int)floor((exposed.right() - _extent.left()) / size);
+	int row0 = (int)floor((exposed.top() - _extent.top()) / size);
+	int row1 = (int)floor((exposed.bottom() - _extent.top()) / size);
+
+	for (int row = row0; row <= row1; row++) {
+		for (int col = col0; col <= col1; col++) {
+			qint64 key = tileKey(level, col, row);
+			QRectF r = tileRect(key);
+
+			QImage* image = _cache.object(key);
+			if (image) {
+				painter->drawImage(r, *image);
+				continue;
+			}
+
+			request(key);
+
+			// stretch the nearest coarser tile over it meanwhile
+			for (int l = level - 1; l >= 0; l--) {
+				int shift = level - l;
+				qint64 coarseKey = tileKey(l, col >> shift, row >> shift);
+				QImage* coarse = _cache.object(coarseKey);
+				if (coarse) {
+					QRectF cr = tileRect(coarseKey);
+					double scale = TILE_PIXELS / cr.width();
+					QRectF source((r.left() - cr.left()) * scale, (r.top() - cr.top()) * scale,
+							r.width() * scale, r.height() * scale);
+					painter->drawImage(r, *coarse, source);
+					break;
+				}
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TilePyramidItem::request(qint64 key) {
+
+	if (_pending.count(key)) {
+		return;
+	}
+
+	if (_snapshot.isNull()) {
+		Snapshot* snapshot = new Snapshot;
+		for (std::map<int, QList<TileLayer> >::iterator i = _layers.begin(); i != _layers.end(); i++) {
+			for (int j = 0; j < i->second.size(); j++) {
+				snapshot->push_back(i->second[j]);
+			}
+		}
+		_snapshot = QSharedPointer<const Snapshot>(snapshot);
+		_scene = _store ? sceneKey() : QString();
+	}
+
+	_pending.insert(key);
+	_threadPool.start(new TileTask(this, key, _generation.load(), _snapshot, _scene));
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TilePyramidItem::renderTile(qint64 key, int generation, QSharedPointer<const Snapshot> snapshot,
+		QString scene) {
+
+	QImage image;
+	if (scene.isEmpty() || !_store->read(scene, key, image)) {
+		image = drawTile(key, *snapshot);
+		// not if it was drawn from geometry that has since been replaced
+		if (!scene.isEmpty() && generation == _generation.load()) {
+			_store->write(scene, key, image);
+		}
+	}
+
+	Finished finished;
+	finished._key = key;
+	finished._generation = generation;
+	finished._image = image;
+	{
+		QMutexLocker locker(&_mutex);
+		_finished.append(finished);
+	}
+	emit tileRendered();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QImage TilePyramidItem::drawTile(qint64 key, const Snapshot& snapshot) const {
+
+	QRectF r = tileRect(key);
+
+	// QImage painting is safe in any thread
+	QImage image(TILE_PIXELS, TILE_PIXELS, QImage::Format_ARGB32_Premultiplied);
+	image.fill(Qt::transparent);
+
+	// Tile row 0 is the minimum y, as in the scene; the view's transform
+	// turns it the right way up when it is blitted.
+	bool raster = _rasterizer;
+	for (unsigned int i = 0; raster && i < snapshot.size(); i++) {
+		raster = TileRasterizer::canDraw(snapshot[i]._pen, snapshot[i]._brush);
+	}
+	if (raster) {
+		if (!rasterizers.hasLocalData()) {
+			rasterizers.setLocalData(new TileRasterizer);
+		}
+		TileRasterizer& rasterizer = *rasterizers.localData();
+		rasterizer.begin(&image, r);
+		for (unsigned int i = 0; i < snapshot.size(); i++) {
+			const TileLayer& layer = snapshot[i];
+			rasterizer.drawParts(layer._polygons, layer._vertices.constData(),
+					layer._partStart.constData(), layer._partBoxes.constData(),
+					layer._partStart.size() - 1, layer._pen, layer._brush);
+		}
+		return image;
+	}
+
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing);
+	double scale = TILE_PIXELS / r.width();
+	painter.scale(scale, scale);
+	painter.translate(-r.left(), -r.top());
+
+	for (unsigned int i = 0; i < snapshot.size(); i++) {
+		const TileLayer& layer = snapshot[i];
+		painter.setPen(layer._pen);
+		painter.setBrush(layer._brush);
+		LayerItem::drawParts(&painter, r, layer._polygons, layer._vertices.constData(),
+				layer._partStart.constData(), layer._partBoxes.constData(),
+				layer._partStart.size() - 1);
+	}
+	painter.end();
+
+	return image;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TilePyramidItem::collectTiles() {
+
+	QList<Finished> finished;
+	{
+		QMutexLocker locker(&_mutex);
+		finished.swap(_finished);
+	}
+
+	QRectF changed;
+	for (int i = 0; i < finished.size(); i++) {
+		// drawn from geometry that has since changed
+		if (finished[i]._generation != _generation.load()) {
+			continue;
+		}
+		qint64 key = finished[i]._key;
+		_pending.erase(key);
+		_cache.insert(key, new QImage(finished[i]._image),
+				qMax(1, (int)(finished[i]._image.sizeInBytes() / 1024)));
+		update(tileRect(key));
+		changed |= tileRect(key);
+	}
+
+	if (!changed.isNull()) {
+		emit tilesUpdated(changed);
+	}
+}
@@ -0,0 +1,208 @@
+/*
+ * TilePyramidItem.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TILEPYRAMIDITEM_H_
+#define TILEPYRAMIDITEM_H_
+
+#include <QtWidgets/QGraphicsObject>
+#include <QtCore/QThreadPool>
+#include <QtCore/QMutex>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QCache>
+#include <QtCore/QVector>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QList>
+#include <QtGui/QImage>
+#include <QtGui/QPen>
+#include <QtGui/QBrush>
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+
+class TileStore;
+
+/////////////////////////////////////////////////////////////////////
+/// @brief Draw the map layers from a pyramid of raster tiles.
+///
+/// The geometry of the layers is copied from their LayerItems. Each
+/// level of the pyramid divides the map into 2^level by 2^level square
+/// tiles of TILE_PIXELS device pixels. paint() chooses the level whose
+/// tiles are at least as sharp as the screen, allowing for the device
+/// pixel ratio, and blits the tiles which are ready. Missing tiles are
+/// rendered into QImages on a private thread pool; until they arrive, the
+/// nearest coarser tile that is ready is stretched over them.
+///
+/// The workers only read a snapshot of the copied geometry, which is
+/// replaced, along with every tile, when a layer changes. Finished tiles
+/// are handed to the GUI thread through the tileRendered() signal, and kept
+/// in an LRU cache.
+///
+/// With a TileStore, the workers look for each tile on disk before
+/// rendering it, and save the ones they render. The tiles are filed under a
+/// hash of everything that goes into them: the source of each layer's
+/// geometry (given by the caller, e.g. the database content hash and table),
+/// the styles, the extent and the tile size.
+///
+/// The tiles are drawn with an antialiasing QPainter, or optionally with a
+/// TileRasterizer, which is faster but does not antialias.
+class TilePyramidItem: public QGraphicsObject {
+	Q_OBJECT
+
+public:
+	/// The width and height of a tile, in device pixels.
+	static const int TILE_PIXELS = 256;
+	/// The finest pyramid level.
+	static const int MAX_LEVEL = 20;
+	/// Constructor
+	/// @param extent The map extent, in scene coordinates.
+	/// @param threads The number of worker threads. Zero for one per core.
+	/// @param parent The parent item.
+	TilePyramidItem(QRectF extent, int threads = 0, QGraphicsItem* parent = 0);
+	/// Destructor. Waits for the workers.
+	virtual ~TilePyramidItem();
+	/// Set the geometry of one layer. The LayerItems among the items are
+	/// copied; anything else is ignored. Every tile is discarded.
+	/// @param index The stacking order of the layer. Higher is drawn on top.
+	/// @param items The graphics items of the layer.
+	/// @param source Identifies the geometry of the items, for the TileStore.
+	/// Blank if it cannot be identified, in which case no tiles are stored.
+	void setLayer(int index, const QList<QGraphicsItem*>& items,
+			const std::string& source = "");
+	/// Remove the geometry of one layer. Every tile is discarded.
+	/// @param index The stacking order of the layer.
+	void removeLayer(int index);
+	/// Identify the geometry of a layer which was set without a source.
+	/// Nothing happens if the layer has not been set.
+	/// @param index The stacking order of the layer.
+	/// @param source Identifies the geometry, for the TileStore.
+	void setSource(int index, const std::string& source);
+	/// Keep the tiles in a TileStore as well as in memory. Every tile is discarded.
+	/// @param store The store, which must outlive the item. 0 for none.
+	void setStore(TileStore* store);
+	/// Draw the tiles with a TileRasterizer instead of QPainter, for the layers
+	/// whose pen and brush it can draw. Every tile is discarded.
+	/// @param on True to use the TileRasterizer.
+	void setRasterizer(bool on);
+	/// @return True if the tiles are drawn with a TileRasterizer.
+	bool rasterizer() const;
+	/// Set the memory allowed for finished tiles. The default is 64 MB.
+	/// @param bytes The budget in bytes.
+	void setCacheBudget(qint64 bytes);
+	/// @return The map extent.
+	virtual QRectF boundingRect() const;
+	/// Blit the tiles which cover the exposed area, and request the missing ones.
+	virtual void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = 0);
+
+signals:
+	/// Emitted from a worker thread when a tile has been rendered.
+	void tileRendered();
+	/// Emitted when tiles have been added or discarded, for a view that
+	/// paints the item into a cached background rather than through the scene.
+	/// @param rect The area which changed, in scene coordinates.
+	void tilesUpdated(const QRectF& rect);
+
+protected slots:
+	/// Move the rendered tiles into the cache, and repaint them.
+	void collectTiles();
+
+protected:
+	/// The task which renders one tile.
+	class TileTask;
+	/// The copied geometry of one LayerItem.
+	class TileLayer {
+	public:
+		/// True if the parts are polygons.
+		bool _polygons;
+		/// The pen.
+		QPen _pen;
+		/// The polygon fill.
+		QBrush _brush;
+		/// The vertices of all parts.
+		QVector<QPointF> _vertices;
+		/// The first vertex of each part, plus one past the end.
+		QVector<quint32> _partStart;
+		/// The bounding box of each part.
+		QVector<double> _partBoxes;
+	};
+	/// Everything the workers draw, in stacking order.
+	typedef std::vector<TileLayer> Snapshot;
+	/// A rendered tile, on its way to the GUI thread.
+	class Finished {
+	public:
+		/// The tile key.
+		qint64 _key;
+		/// The value of _generation when the tile was requested.
+		int _generation;
+		/// The image.
+		QImage _image;
+	};
+	/// Forget every tile, after the geometry has changed.
+	void invalidate();
+	/// Queue a tile for rendering, unless it is already queued.
+	/// @param key The tile.
+	void request(qint64 key);
+	/// Render one tile. Called by the worker threads.
+	/// @param key The tile.
+	/// @param generation The value of _generation when the tile was requested.
+	/// @param snapshot The geometry.
+	/// @param scene The TileStore key of the snapshot. Blank if it is not stored.
+	void renderTile(qint64 key, int generation, QSharedPointer<const Snapshot> snapshot,
+			QString scene);
+	/// @return A tile, drawn from the geometry.
+	/// @param key The tile.
+	/// @param snapshot The geometry.
+	QImage drawTile(qint64 key, const Snapshot& snapshot) const;
+	/// @return The TileStore key for the current layers, or blank if one
+	/// of them has no source.
+	QString sceneKey() const;
+	/// @return The level whose tiles have at least as many pixels per scene
+	/// unit as the device.
+	/// @param devicePixelsPerUnit The device pixels per scene unit.
+	int tileLevel(double devicePixelsPerUnit) const;
+	/// @return The width and height of a tile, in scene units.
+	/// @param level The pyramid level.
+	double tileSize(int level) const;
+	/// @return The area covered by a tile, in scene coordinates.
+	/// @param key The tile.
+	QRectF tileRect(qint64 key) const;
+	/// @return The key for a tile.
+	/// @param level The pyramid level.
+	/// @param col The tile column, counted from the minimum x.
+	/// @param row The tile row, counted from the minimum y.
+	static qint64 tileKey(int level, int col, int row);
+	/// The map extent.
+	QRectF _extent;
+	/// The copied geometry, by stacking order.
+	std::map<int, QList<TileLayer> > _layers;
+	/// The source of each layer's geometry, by stacking order.
+	std::map<int, std::string> _sources;
+	/// The geometry given to the workers. Null until needed after a change.
+	QSharedPointer<const Snapshot> _snapshot;
+	/// The TileStore key of _snapshot.
+	QString _scene;
+	/// The on disk tiles. 0 for none.
+	TileStore* _store;
+	/// True if the tiles are drawn with a TileRasterizer.
+	bool _rasterizer;
+	/// Incremented when the geometry changes, so that late tiles are discarded,
+	/// and not stored.
+	QAtomicInt _generation;
+	/// The level that was painted last.
+	int _paintLevel;
+	/// The tiles that have been queued and not collected.
+	std::set<qint64> _pending;
+	/// The rendered tiles. The cost is in kilobytes.
+	QCache<qint64, QImage> _cache;
+	/// Rendered tiles waiting for collectTiles().
+	QList<Finished> _finished;
+	/// Protects _finished.
+	QMutex _mutex;
+	/// The worker threads.
+	QThreadPool _threadPool;
+};
+
+#endif /* TILEPYRAMIDITEM_H_ */
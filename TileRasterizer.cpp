@@ -0,0 +1,331 @@
+/*
+ * TileRasterizer.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "TileRasterizer.h"
+#include <algorithm>
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+TileRasterizer::TileRasterizer():
+	_bits(0),
+	_stride(0),
+	_width(0),
+	_height(0),
+	_sx(1.0),
+	_sy(1.0),
+	_x0(0.0),
+	_y0(0.0) {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+TileRasterizer::~TileRasterizer() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TileRasterizer::begin(QImage* image, const QRectF& rect) {
+
+	Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
+
+	_bits = image->bits();
+	_stride = image->bytesPerLine();
+	_width = image->width();
+	_height = image->height();
+	_rect = rect;
+	_sx = _width / rect.width();
+	_sy = _height / rect.height();
+	_x0 = rect.left();
+	_y0 = rect.top();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool TileRasterizer::canDraw(const QPen& pen, const QBrush& brush) {
+
+	bool brushOk = brush.style() == Qt::NoBrush || brush.style() == Qt::SolidPattern;
+	bool penOk = pen.style() == Qt::NoPen ||
+			(pen.style() == Qt::SolidLine && pen.isCosmetic() && pen.widthF() <= 1.0);
+	return brushOk && penOk;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool TileRasterizer::edgeAbove(const Edge& a, const Edge& b) {
+	return a._y0 < b._y0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TileRasterizer::toPixels(const QPointF* v, int n) {
+
+	if (_points.size() < n) {
+		_points.resize(n);
+	}
+	QPointF* p = _points.data();
+	for (int i = 0; i < n; i++) {
+		p[i] = QPointF((v[i].x() - _x0) * _sx, (v[i].y() - _y0) * _sy);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TileRasterizer::blend(quint32* p, QRgb color) {
+
+	// src + dst * (255 - src alpha) / 255, rounded, for each channel
+	quint32 inv = 255 - qAlpha(color);
+	quint32 d = *p;
+	quint32 result = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		quint32 t = ((d >> shift) & 0xff) * inv + 0x80;
+		t = (t + (t >> 8)) >> 8;
+		result |= (((color >> shift) & 0xff) + t) << shift;
+	}
+	*p = result;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TileRasterizer::fillSpan(int y, int x0, int x1, QRgb color) {
+
+	quint32* row = (quint32*)(_bits + y * _stride);
+	int x = x0;
+
+	if (qAlpha(color) == 255) {
+#ifdef __SSE2__
+		const __m128i c = _mm_set1_epi32(color);
+		for (; x + 4 <= x1; x += 4) {
+			_mm_storeu_si128((__m128i*)(row + x), c);
+		}
+#endif
+		for (; x < x1; x++) {
+			row[x] = color;
+		}
+		return;
+	}
+
+#ifdef __SSE2__
+	// the same arithmetic as blend(), on four pixels at once
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i src = _mm_set1_epi32(color);
+	const __m128i inv = _mm_set1_epi16(255 - qAlpha(color));
+	const __m128i half = _mm_set1_epi16(0x80);
+	for (; x + 4 <= x1; x += 4) {
+		__m128i d = _mm_loadu_si128((const __m128i*)(row + x));
+		__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), inv), half);
+		__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), inv), half);
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+		_mm_storeu_si128((__m128i*)(row + x), _mm_add_epi8(src, _mm_packus_epi16(lo, hi)));
+	}
+#endif
+	for (; x < x1; x++) {
+		blend(row + x, color);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TileRasterizer::fillPolygon(const QPointF* v, int n, QRgb color) {
+
+	if (n < 3) {
+		return;
+	}
+	toPixels(v, n);
+	const QPointF* p = _points.constData();
+	color = qPremultiply(color);
+
+	// the edges, top to bottom, leaving out the horizontal ones
+	int edges = 0;
+	if (_edges.size() < n) {
+		_edges.resize(n);
+	}
+	double ymin = p[0].y();
+	double ymax = ymin;
+	for (int i = 0; i < n; i++) {
+		QPointF a = p[i];
+		QPointF b = p[i + 1 < n ? i + 1 : 0];
+		ymin = qMin(ymin, a.y());
+		ymax = qMax(ymax, a.y());
+		if (a.y() == b.y()) {
+			continue;
+		}
+		if (a.y() > b.y()) {
+			std::swap(a, b);
+		}
+		Edge& e = _edges[edges++];
+		e._x0 = a.x();
+		e._y0 = a.y();
+		e._y1 = b.y();
+		e._dxdy = (b.x() - a.x()) / (b.y() - a.y());
+	}
+	Edge* edge = _edges.data();
+	std::sort(edge, edge + edges, edgeAbove);
+
+	// the rows whose centres are inside the polygon's extent
+	int row0 = qMax(0, (int)ceil(ymin - 0.5));
+	int row1 = qMin(_height, (int)ceil(ymax - 0.5));
+
+	if (_active.size() < edges) {
+		_active.resize(edges);
+		_crossings.resize(edges);
+	}
+	int* active = _active.data();
+	double* crossings = _crossings.data();
+	int actives = 0;
+	int next = 0;
+
+	for (int y = row0; y < row1; y++) {
+		double yc = y + 0.5;
+
+		// the edges which now cross the row centre, and those which no longer do
+		while (next < edges && edge[next]._y0 <= yc) {
+			active[actives++] = next++;
+		}
+		int kept = 0;
+		for (int i = 0; i < actives; i++) {
+			if (edge[active[i]]._y1 > yc) {
+				active[kept++] = active[i];
+			}
+		}
+		actives = kept;
+
+		// where they cross it, left to right
+		for (int i = 0; i < actives; i++) {
+			const Edge& e = edge[active[i]];
+			double x = e._x0 + (yc - e._y0) * e._dxdy;
+			int j = i;
+			for (; j > 0 && crossings[j-1] > x; j--) {
+				crossings[j] = crossings[j-1];
+			}
+			crossings[j] = x;
+		}
+
+		// odd-even: fill the pixels whose centres are between each pair
+		for (int i = 0; i + 1 < actives; i += 2) {
+			int x0 = (int)qBound(0.0, ceil(crossings[i] - 0.5), (double)_width);
+			int x1 = (int)qBound(0.0, ceil(crossings[i+1] - 0.5), (double)_width);
+			if (x1 > x0) {
+				fillSpan(y, x0, x1, color);
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TileRasterizer::drawPolyline(const QPointF* v, int n, QRgb color, bool closed) {
+
+	if (n < 1) {
+		return;
+	}
+	toPixels(v, n);
+	const QPointF* p = _points.constData();
+	color = qPremultiply(color);
+
+	if (n == 1) {
+		drawSegment(p[0], p[0], color, true);
+		return;
+	}
+	for (int i = 0; i + 1 < n; i++) {
+		drawSegment(p[i], p[i+1], color, i + 2 == n && !closed);
+	}
+	if (closed && n > 2) {
+		drawSegment(p[n-1], p[0], color, false);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TileRasterizer::drawSegment(QPointF a, QPointF b, QRgb color, bool last) {
+
+	// clip to the image (Liang-Barsky); a pixel is the floor of its coordinates
+	double xmax = _width - 1.0e-6;
+	double ymax = _height - 1.0e-6;
+	double dx = b.x() - a.x();
+	double dy = b.y() - a.y();
+	double t0 = 0.0;
+	double t1 = 1.0;
+	double p[4] = { -dx, dx, -dy, dy };
+	double q[4] = { a.x(), xmax - a.x(), a.y(), ymax - a.y() };
+	for (int e = 0; e < 4; e++) {
+		if (p[e] == 0.0) {
+			if (q[e] < 0.0) {
+				return;
+			}
+		} else {
+			double t = q[e] / p[e];
+			if (p[e] < 0.0) {
+				t0 = qMax(t0, t);
+			} else {
+				t1 = qMin(t1, t);
+			}
+		}
+	}
+	if (t0 > t1) {
+		return;
+	}
+	// the end was cut off, so no other segment will plot it
+	if (t1 < 1.0) {
+		last = true;
+	}
+
+	int x = (int)floor(a.x() + t0 * dx);
+	int y = (int)floor(a.y() + t0 * dy);
+	int x1 = (int)floor(a.x() + t1 * dx);
+	int y1 = (int)floor(a.y() + t1 * dy);
+
+	// Bresenham
+	int ax = abs(x1 - x);
+	int ay = -abs(y1 - y);
+	int stepx = x < x1 ? 1 : -1;
+	int stepy = y < y1 ? 1 : -1;
+	int err = ax + ay;
+	bool opaque = qAlpha(color) == 255;
+
+	for (;;) {
+		bool end = x == x1 && y == y1;
+		if ((!end || last) && x >= 0 && x < _width && y >= 0 && y < _height) {
+			quint32* pixel = (quint32*)(_bits + y * _stride) + x;
+			if (opaque) {
+				*pixel = color;
+			} else {
+				blend(pixel, color);
+			}
+		}
+		if (end) {
+			break;
+		}
+		int e2 = 2 * err;
+		if (e2 >= ay) {
+			err += ay;
+			x += stepx;
+		}
+		if (e2 <= ax) {
+			err += ax;
+			y += stepy;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TileRasterizer::drawParts(bool polygons, const QPointF* vertices, const quint32* partStart,
+		const double* partBoxes, int parts, const QPen& pen, const QBrush& brush) {
+
+	bool fill = polygons && brush.style() == Qt::SolidPattern;
+	bool stroke = pen.style() != Qt::NoPen;
+	QRgb fillColor = brush.color().rgba();
+	QRgb penColor = pen.color().rgba();
+
+	for (int n = 0; n < parts; n++) {
+		const double* b = partBoxes + 4*n;
+		if (b[0] > _rect.right() || b[2] < _rect.left() ||
+				b[1] > _rect.bottom() || b[3] < _rect.top()) {
+			continue;
+		}
+		const QPointF* v = vertices + partStart[n];
+		int count = partStart[n+1] - partStart[n];
+		if (fill) {
+			fillPolygon(v, count, fillColor);
+		}
+		if (stroke) {
+			drawPolyline(v, count, penColor, polygons);
+		}
+	}
+}
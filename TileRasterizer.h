@@ -0,0 +1,132 @@
+/*
+ * TileRasterizer.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TILERASTERIZER_H_
+#define TILERASTERIZER_H_
+
+#include <QtCore/QPointF>
+#include <QtCore/QRectF>
+#include <QtCore/QVector>
+#include <QtGui/QImage>
+#include <QtGui/QPen>
+#include <QtGui/QBrush>
+
+/////////////////////////////////////////////////////////////////////
+/// @brief Draw map layers into a tile image, without QPainter.
+///
+/// The map layers are flat, single colour polygon fills and hairline
+/// strokes, which need none of QPainter's general path handling.
+/// Polygons are filled with the odd-even rule by a scanline filler,
+/// which samples pixel centres, and writes whole spans at a time, four
+/// pixels to an SSE2 store where available. Hairlines are drawn with
+/// Bresenham's algorithm, after clipping to the image. Nothing is
+/// antialiased; the result is meant to match QPainter drawing without
+/// antialiasing, to within a pixel along the edges.
+///
+/// Pixels are written straight into a QImage::Format_ARGB32_Premultiplied
+/// image. Opaque colours overwrite; translucent ones are blended over.
+/// The scratch buffers are kept between calls, so a rasterizer which is
+/// reused for many tiles allocates only while they grow.
+class TileRasterizer {
+public:
+	/// Constructor
+	TileRasterizer();
+	/// Destructor
+	virtual ~TileRasterizer();
+	/// Start drawing into an image.
+	/// @param image The image, which must be Format_ARGB32_Premultiplied,
+	/// and must outlive the drawing.
+	/// @param rect The area that the image covers, in scene coordinates.
+	/// Scene y increases with the image rows.
+	void begin(QImage* image, const QRectF& rect);
+	/// Fill a polygon.
+	/// @param v The vertices, in scene coordinates.
+	/// @param n The number of vertices.
+	/// @param color The colour.
+	void fillPolygon(const QPointF* v, int n, QRgb color);
+	/// Draw a hairline through a run of vertices.
+	/// @param v The vertices, in scene coordinates.
+	/// @param n The number of vertices.
+	/// @param color The colour.
+	/// @param closed True to join the last vertex back to the first.
+	void drawPolyline(const QPointF* v, int n, QRgb color, bool closed = false);
+	/// Draw the parts which intersect the image, as LayerItem::drawParts()
+	/// does with QPainter: fill each polygon with the brush, then outline it
+	/// with the pen, or draw each linestring with the pen. Only solid brushes
+	/// and cosmetic pens are drawn.
+	/// @param polygons True if the parts are polygons, false for linestrings.
+	/// @param vertices The vertices of all parts.
+	/// @param partStart The first vertex of each part, plus one past the end.
+	/// @param partBoxes The bounding box of each part: xmin, ymin, xmax, ymax.
+	/// @param parts The number of parts.
+	/// @param pen The pen.
+	/// @param brush The polygon fill.
+	void drawParts(bool polygons, const QPointF* vertices, const quint32* partStart,
+			const double* partBoxes, int parts, const QPen& pen, const QBrush& brush);
+	/// @return True if drawParts() can draw with a pen and brush.
+	/// @param pen The pen.
+	/// @param brush The brush.
+	static bool canDraw(const QPen& pen, const QBrush& brush);
+
+protected:
+	/// A polygon edge, in pixel coordinates, with y0 < y1.
+	class Edge {
+	public:
+		double _x0;
+		double _y0;
+		double _y1;
+		/// The change in x for each unit of y.
+		double _dxdy;
+	};
+	/// @return True if edge a starts above edge b.
+	static bool edgeAbove(const Edge& a, const Edge& b);
+	/// Map the vertices to pixel coordinates, into _points.
+	/// @param v The vertices.
+	/// @param n The number of vertices.
+	void toPixels(const QPointF* v, int n);
+	/// Fill pixels [x0, x1) of a row.
+	/// @param y The row.
+	/// @param x0 The first pixel.
+	/// @param x1 One past the last pixel.
+	/// @param color The premultiplied colour.
+	void fillSpan(int y, int x0, int x1, QRgb color);
+	/// Draw a hairline segment, in pixel coordinates.
+	/// @param a The start.
+	/// @param b The end.
+	/// @param color The premultiplied colour.
+	/// @param last True to plot the end pixel, which the next segment would otherwise plot.
+	void drawSegment(QPointF a, QPointF b, QRgb color, bool last);
+	/// Blend one pixel, which must be inside the image.
+	/// @param p The pixel.
+	/// @param color The premultiplied colour.
+	static inline void blend(quint32* p, QRgb color);
+	/// The image bits.
+	uchar* _bits;
+	/// The bytes per image row.
+	int _stride;
+	/// The image width.
+	int _width;
+	/// The image height.
+	int _height;
+	/// Pixels per scene unit, in x and y.
+	double _sx;
+	double _sy;
+	/// The scene coordinates of the image's top left corner.
+	double _x0;
+	double _y0;
+	/// The area that the image covers, in scene coordinates.
+	QRectF _rect;
+	/// Scratch: the vertices in pixel coordinates.
+	QVector<QPointF> _points;
+	/// Scratch: the edges of the polygon being filled, sorted by y0.
+	QVector<Edge> _edges;
+	/// Scratch: the edges crossing the current row.
+	QVector<int> _active;
+	/// Scratch: where they cross it.
+	QVector<double> _crossings;
+};
+
+#endif /* TILERASTERIZER_H_ */
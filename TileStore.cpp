@@ -0,0 +1,165 @@
+/*
+ * TileStore.cpp
+ *
+ *  Created on: Oct 17, 2026
+ */
+#include "TileStore.h"
+#include <QtCore/QDir>
+#include <QtCore/QDirIterator>
+#include <QtCore/QFileInfo>
+#include <QtCore/QDateTime>
+#include <QtCore/QSaveFile>
+#include <QtCore/QStandardPaths>
+#include <sys/types.h>
+#include <utime.h>
+#include <algorithm>
+#include <vector>
+
+/// The default size cap.
+static const qint64 TILE_STORE_BYTES = 256 * 1024 * 1024;
+
+/// A trim leaves the store at this fraction of the cap, so that it does
+/// not have to trim again on the next write.
+static const double TRIM_FRACTION = 0.9;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief A tile file, for sorting by the time of last use.
+class TileFile {
+public:
+	TileFile(QString path, qint64 size, qint64 used):
+		_path(path), _size(size), _used(used) {
+	}
+	bool operator<(const TileFile& other) const {
+		return _used < other._used;
+	}
+	QString _path;
+	qint64 _size;
+	qint64 _used;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+TileStore::TileStore(std::string directory, qint64 maxBytes):
+	_directory(QString::fromStdString(directory.empty() ? defaultDirectory() : directory)),
+	_maxBytes(maxBytes > 0 ? maxBytes : TILE_STORE_BYTES),
+	_bytes(0) {
+
+	QDir().mkpath(_directory);
+
+	// measures the store, and brings it under a cap that may have been lowered
+	trim();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+TileStore::~TileStore() {
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string TileStore::defaultDirectory() {
+	return (QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+			+ "/qmicromap/tiles").toStdString();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+std::string TileStore::directory() const {
+	return _directory.toStdString();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+qint64 TileStore::bytes() {
+	QMutexLocker locker(&_mutex);
+	return _bytes;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+QString TileStore::tilePath(const QString& scene, qint64 key) const {
+
+	int level = key >> 48;
+	int row = (key >> 24) & 0xffffff;
+	int col = key & 0xffffff;
+
+	return QString("%1/%2/%3/%4_%5.png").arg(_directory).arg(scene).arg(level).arg(col).arg(row);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool TileStore::read(const QString& scene, qint64 key, QImage& image) {
+
+	QString path = tilePath(scene, key);
+	if (!image.load(path, "PNG")) {
+		return false;
+	}
+
+	// mark it as recently used
+	utime(QFile::encodeName(path).constData(), 0);
+
+	if (image.format() != QImage::Format_ARGB32_Premultiplied) {
+		image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool TileStore::write(const QString& scene, qint64 key, const QImage& image) {
+
+	QString path = tilePath(scene, key);
+	QDir().mkpath(QFileInfo(path).path());
+
+	// QSaveFile writes to a temporary file, and renames it on commit(),
+	// so a reader never sees a partial tile.
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly) || !image.save(&file, "PNG")) {
+		file.cancelWriting();
+		return false;
+	}
+	qint64 size = file.size();
+	if (!file.commit()) {
+		return false;
+	}
+
+	bool full;
+	{
+		QMutexLocker locker(&_mutex);
+		_bytes += size;
+		full = _bytes > _maxBytes;
+	}
+	if (full) {
+		trim();
+	}
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void TileStore::trim() {
+
+	// another thread is already at it
+	if (!_trimMutex.tryLock()) {
+		return;
+	}
+
+	// Other processes write to the store too, so measure it afresh.
+	std::vector<TileFile> files;
+	qint64 total = 0;
+	QDirIterator i(_directory, QStringList("*.png"), QDir::Files, QDirIterator::Subdirectories);
+	while (i.hasNext()) {
+		i.next();
+		QFileInfo info = i.fileInfo();
+		files.push_back(TileFile(info.filePath(), info.size(), info.lastModified().toMSecsSinceEpoch()));
+		total += info.size();
+	}
+
+	if (total > _maxBytes) {
+		std::sort(files.begin(), files.end());
+		qint64 target = (qint64)(_maxBytes * TRIM_FRACTION);
+		for (unsigned int f = 0; f < files.size() && total > target; f++) {
+			// it may already have gone, to another process
+			QFile::remove(files[f]._path);
+			total -= files[f]._size;
+		}
+	}
+
+	{
+		QMutexLocker locker(&_mutex);
+		_bytes = total;
+	}
+
+	_trimMutex.unlock();
+}
@@ -0,0 +1,78 @@
+/*
+ * TileStore.h
+ *
+ *  Created on: Oct 17, 2026
+ */
+
+#ifndef TILESTORE_H_
+#define TILESTORE_H_
+
+#include <QtCore/QString>
+#include <QtCore/QMutex>
+#include <QtGui/QImage>
+#include <string>
+
+/////////////////////////////////////////////////////////////////////
+/// @brief Keep rendered map tiles on disk, so that they can be reused
+/// by later sessions, and by other processes drawing the same map.
+///
+/// The tiles are PNG files in a directory tree:
+/// <directory>/<scene>/<level>/<col>_<row>.png. The scene is a key chosen
+/// by the caller that identifies everything drawn in the tile, such as
+/// the content of the database, the tables, the styles and the map extent
+/// (see TilePyramidItem).
+///
+/// Each tile is written to a temporary file which is renamed into place,
+/// so a reader, in this process or another, only ever sees complete tiles.
+/// When the files add up to more than the size cap, the least recently used
+/// tiles are deleted. Reading a tile updates its modification time, which
+/// serves as the time of last use.
+///
+/// read() and write() may be called from any thread.
+class TileStore {
+public:
+	/// Constructor
+	/// @param directory The root of the tree. Blank for defaultDirectory().
+	/// @param maxBytes The size cap. Zero for 256 MB.
+	TileStore(std::string directory = "", qint64 maxBytes = 0);
+	/// Destructor
+	virtual ~TileStore();
+	/// Read a tile.
+	/// @param scene The scene key.
+	/// @param key The tile, as made by TilePyramidItem.
+	/// @param image The tile is returned here.
+	/// @return False if the tile is not in the store.
+	bool read(const QString& scene, qint64 key, QImage& image);
+	/// Save a tile, and trim the store if it has grown past the cap.
+	/// @param scene The scene key.
+	/// @param key The tile, as made by TilePyramidItem.
+	/// @param image The tile.
+	/// @return False if the tile could not be written.
+	bool write(const QString& scene, qint64 key, const QImage& image);
+	/// Delete the least recently used tiles, until the store is well under the cap.
+	void trim();
+	/// @return The estimated size of the store, in bytes.
+	qint64 bytes();
+	/// @return The root of the tree.
+	std::string directory() const;
+	/// @return The per user cache location shared by all maps.
+	static std::string defaultDirectory();
+
+protected:
+	/// @return The path of a tile.
+	/// @param scene The scene key.
+	/// @param key The tile.
+	QString tilePath(const QString& scene, qint64 key) const;
+	/// The root of the tree.
+	QString _directory;
+	/// The size cap.
+	qint64 _maxBytes;
+	/// The size of the tiles, as of the last trim() plus what has been written since.
+	qint64 _bytes;
+	/// Protects _bytes.
+	QMutex _mutex;
+	/// Held while trimming, so that only one thread trims at a time.
+	QMutex _trimMutex;
+};
+
+#endif /* TILESTORE_H_ */
@@ -14,7 +14,9 @@ QMicroMapTest::QMicroMapTest(SpatiaLiteDB& db,
 		double xmax,
 		double ymax,
 		std::string backgroundColor,
-		QWidget* parent):
+		QWidget* parent,
+		QMicroMap::LOAD_MODE loadMode,
+		qint64 memoryBudget):
 QDialog(parent),
 _xmin(xmin),
 _ymin(ymin),
@@ -29,7 +31,7 @@ _zoomInc(0.1)
 	QVBoxLayout* vb = new QVBoxLayout(frame);
 
 	// create the micromap and add to the layout
-	_mm = new QMicroMap(db, _xmin, _ymin, _xmax, _ymax, backgroundColor);
+	_mm = new QMicroMap(db, _xmin, _ymin, _xmax, _ymax, backgroundColor, 0, loadMode, memoryBudget);
 	vb->addWidget(_mm);
 
 	// collect a list of stations, which will e added to an item group
@@ -103,6 +105,30 @@ QMicroMapTest::~QMicroMapTest() {
 
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMapTest::addDatabase(std::string dbPath, double maxSpan) {
+
+	_mm->addDatabase(dbPath, maxSpan);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMapTest::setRasterTiles(bool on) {
+
+	_mm->setRasterTiles(on);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void QMicroMapTest::setTileStore(std::string directory, qint64 maxBytes) {
+
+	_mm->setTileStore(directory, maxBytes);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+bool QMicroMapTest::usesGeometryCache() const {
+
+	return _mm->usesGeometryCache();
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////////
 void QMicroMapTest::mouseSlot(bool b) {
 
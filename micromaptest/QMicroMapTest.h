@@ -21,8 +21,19 @@ public:
 			double xmax,
 			double ymax,
 			std::string backGroundColor = "white",
-			QWidget* parent = 0);
+			QWidget* parent = 0,
+			QMicroMap::LOAD_MODE loadMode = QMicroMap::LOAD_SYNC,
+			qint64 memoryBudget = 0);
 	virtual ~QMicroMapTest();
+	/// Add a more detailed database to the map. See QMicroMap::addDatabase().
+	void addDatabase(std::string dbPath, double maxSpan);
+	/// Draw the map from raster tiles. See QMicroMap::setRasterTiles().
+	void setRasterTiles(bool on);
+	/// Keep the raster tiles in a store on disk. See QMicroMap::setTileStore().
+	void setTileStore(std::string directory = "", qint64 maxBytes = 0);
+	/// @return True if the map is drawn from a geometry cache. See
+	/// QMicroMap::usesGeometryCache().
+	bool usesGeometryCache() const;
 
 public slots:
 	void obsSlot(int);
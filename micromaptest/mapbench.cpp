@@ -0,0 +1,1210 @@
+/*
+ * mapbench.cpp
+ *
+ *  Created on: Oct 17, 2026
+ *
+ *  Timing measurements for QMicroMap. Each benchmark is selected
+ *  by name on the command line, and prints its results to stdout.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <QtWidgets/QApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QSet>
+#include <QtGui/QImage>
+#include <QtGui/QPainter>
+#include <QtWidgets/QGraphicsScene>
+#include <QtGui/QMouseEvent>
+#include "QMicroMap.h"
+#include "QStationModelGraphicsItem.h"
+#include "LayerItem.h"
+#include "PointTransform.h"
+#include "TileRasterizer.h"
+#include "QMicroMapLoader.h"
+#include "MapLayer.h"
+#include "SpatiaLiteConnection.h"
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+// Heap accounting. On glibc, malloc and friends are replaced by wrappers
+// around the libc versions, so that every allocation in the process, Qt and
+// sqlite included, is counted while _counting is set.
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+extern "C" void __libc_free(void* p);
+
+static volatile bool _counting = false;
+static long _allocs = 0;
+static long _allocBytes = 0;
+static long _liveBytes = 0;
+static long _peakBytes = 0;
+
+static void allocated(void* p) {
+	if (_counting && p) {
+		long size = malloc_usable_size(p);
+		__sync_fetch_and_add(&_allocs, 1);
+		__sync_fetch_and_add(&_allocBytes, size);
+		long live = __sync_add_and_fetch(&_liveBytes, size);
+		if (live > _peakBytes) {
+			_peakBytes = live;
+		}
+	}
+}
+
+static void freed(void* p) {
+	if (_counting && p) {
+		__sync_fetch_and_sub(&_liveBytes, (long)malloc_usable_size(p));
+	}
+}
+
+extern "C" void* malloc(size_t size) {
+	void* p = __libc_malloc(size);
+	allocated(p);
+	return p;
+}
+
+extern "C" void* calloc(size_t n, size_t size) {
+	void* p = __libc_calloc(n, size);
+	allocated(p);
+	return p;
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+	freed(p);
+	void* q = __libc_realloc(p, size);
+	allocated(q);
+	return q;
+}
+
+extern "C" void free(void* p) {
+	freed(p);
+	__libc_free(p);
+}
+#define HEAP_ACCOUNTING 1
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Expose the protected parts of QMicroMap to the benchmarks.
+class BenchMap: public QMicroMap {
+public:
+	BenchMap(SpatiaLiteDB& db, double xmin, double ymin, double xmax, double ymax,
+			LOAD_MODE loadMode = LOAD_SYNC, bool batchLayers = true):
+		QMicroMap(db, xmin, ymin, xmax, ymax, "white", 0, loadMode) {
+		if (!batchLayers) {
+			// redraw, from the query cache, with an item per geometry
+			for (unsigned int i = 0; i < _features.size(); i++) {
+				removeLayer(i);
+			}
+			_geometryCache.close();
+			_batchLayers = false;
+			drawFeatures();
+		}
+	}
+	std::vector<Feature*>& features() {
+		return _features;
+	}
+	/// Zoom, as the rubber band does.
+	void zoomTo(const QRectF& rect) {
+		_zoomRectStack.push(rect);
+		fitInView(rect);
+		updateLevelOfDetail(rect);
+	}
+	/// Move the grid, as a zoom does.
+	using QMicroMap::drawGrid;
+	/// Turn paint time clipping on or off for every layer.
+	void setClipping(bool on) {
+		QList<QGraphicsItem*> items = scene()->items();
+		for (int i = 0; i < items.size(); i++) {
+			LayerItem* item = dynamic_cast<LayerItem*>(items[i]);
+			if (item) {
+				item->setClipping(on);
+			}
+		}
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief The command line settings.
+struct BenchOptions {
+	std::string dbPath;
+	std::string test;
+	double xmin;
+	double ymin;
+	double xmax;
+	double ymax;
+	int repeats;
+	int threads;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void usage(char* argv0) {
+	std::cerr << "usage: " << argv0
+			<< " -d db_path [-b xmin,ymin,xmax,ymax] [-n repeats] [-j threads] test" << std::endl;
+	std::cerr << "tests:" << std::endl;
+	std::cerr << "  load    serial versus parallel feature loading" << std::endl;
+	std::cerr << "  stream  heap use of copied versus streamed geometry" << std::endl;
+	std::cerr << "  frame   frame time panning the map, item per geometry versus item per layer" << std::endl;
+	std::cerr << "  hover   hover latency over 5000 station models, without and with the cached background" << std::endl;
+	std::cerr << "  clip    frame time zoomed into coastlines, without and with paint time clipping" << std::endl;
+	std::cerr << "  decimate  frame time at continental scale, without and with vertex decimation" << std::endl;
+	std::cerr << "  transform points per second mapped to device pixels, for each instruction set" << std::endl;
+	std::cerr << "  picture frame time of the scene items against display lists, per geometry and per layer" << std::endl;
+	std::cerr << "  drag    frame rate of a scripted pan, at full and at interactive quality" << std::endl;
+	std::cerr << "  raster  tiles per second drawn by QPainter against the TileRasterizer" << std::endl;
+	std::cerr << "  grid    zoom time with the grid on, and the scene items created by zooming" << std::endl;
+	std::cerr << "  annotate  frame time changing the corner annotations every frame" << std::endl;
+	std::cerr << "  zoomback  time to the first frame after a right click zoom back, without and with snapshots" << std::endl;
+	std::cerr << "  resize  paint calls per second during a scripted resize, without and with the stretched preview" << std::endl;
+	std::cerr << "  coalesce  animation step time, redrawing after every change against once per step" << std::endl;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+void getOptions(int argc, char** argv, BenchOptions& opts) {
+
+	extern char *optarg;
+	extern int optind;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "b:d:j:n:")) != -1) {
+		switch (opt) {
+		case 'b': {
+			std::string arg(optarg);
+			std::vector<std::string> tokens;
+			std::string::size_type lastPos = arg.find_first_not_of(",", 0);
+			std::string::size_type pos     = arg.find_first_of(",", lastPos);
+
+			while (std::string::npos != pos || std::string::npos != lastPos)
+			{
+				tokens.push_back(arg.substr(lastPos, pos - lastPos));
+				lastPos = arg.find_first_not_of(",", pos);
+				pos     = arg.find_first_of(",", lastPos);
+			}
+			if (tokens.size() != 4) {
+				usage(argv[0]);
+				exit(1);
+			}
+			opts.xmin = atof(tokens[0].c_str());
+			opts.ymin = atof(tokens[1].c_str());
+			opts.xmax = atof(tokens[2].c_str());
+			opts.ymax = atof(tokens[3].c_str());
+			break;
+		}
+		case 'd':
+			opts.dbPath = optarg;
+			break;
+		case 'j':
+			opts.threads = atoi(optarg);
+			break;
+		case 'n':
+			opts.repeats = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if (optind < argc) {
+		opts.test = argv[optind];
+	}
+
+	if (opts.dbPath == "" || opts.test == "" || opts.repeats < 1) {
+		usage(argv[0]);
+		exit(1);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Print one timing result.
+void report(std::string label, qint64 nsecs, int repeats) {
+	std::cout << std::setw(32) << std::left << label
+			<< std::setw(10) << std::right << std::fixed << std::setprecision(1)
+			<< (double)nsecs / repeats / 1.0e6 << " ms" << std::endl;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Compare the wall time of loading every feature serially on one
+/// connection, against the parallel loader.
+void benchLoad(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	// The first construction also warms up the file system cache.
+	BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+	std::vector<Feature*>& features = map.features();
+
+	std::vector<LayerRequest> requests;
+	for (unsigned int i = 0; i < features.size(); i++) {
+		requests.push_back(LayerRequest(i, features[i], features[i]->_tableName,
+				opts.xmin, opts.ymin, opts.xmax, opts.ymax));
+	}
+
+	int threads = opts.threads > 0 ? opts.threads : QMicroMapLoader::defaultThreads(requests.size());
+	std::cout << requests.size() << " features, " << threads << " threads" << std::endl;
+
+	QElapsedTimer timer;
+
+	SpatiaLiteConnection connection(db.dbPath());
+
+	timer.start();
+	for (int r = 0; r < opts.repeats; r++) {
+		for (unsigned int i = 0; i < requests.size(); i++) {
+			MapLayer layer(i);
+			QMicroMapLoader::loadLayer(connection, requests[i], layer);
+		}
+	}
+	qint64 serial = timer.nsecsElapsed();
+	report("query serial", serial, opts.repeats);
+
+	timer.start();
+	for (int r = 0; r < opts.repeats; r++) {
+		// includes opening the pool connections
+		QMicroMapLoader loader(db.dbPath(), requests, threads);
+		loader.start();
+		loader.wait();
+	}
+	qint64 parallel = timer.nsecsElapsed();
+	report("query parallel", parallel, opts.repeats);
+	std::cout << "speedup " << (double)serial / parallel << std::endl;
+
+	// The complete constructor, including scene building.
+	QMicroMap::LOAD_MODE modes[2] = { QMicroMap::LOAD_SYNC, QMicroMap::LOAD_PARALLEL };
+	std::string names[2] = { "QMicroMap LOAD_SYNC", "QMicroMap LOAD_PARALLEL" };
+	for (int m = 0; m < 2; m++) {
+		timer.start();
+		for (int r = 0; r < opts.repeats; r++) {
+			BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax, modes[m]);
+		}
+		report(names[m], timer.nsecsElapsed(), opts.repeats);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Compare the heap traffic of building every layer through the copied
+/// SpatiaLiteDB result lists, against streaming the geometry into the
+/// layer. The peak is the most heap in use at once, above what was in use
+/// beforehand, and includes the finished layer.
+void benchStream(SpatiaLiteDB& db, BenchOptions& opts) {
+
+#ifndef HEAP_ACCOUNTING
+	std::cout << "heap accounting is only available with glibc; reporting times only" << std::endl;
+#endif
+
+	BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+	std::vector<Feature*>& features = map.features();
+	SpatiaLiteConnection connection(db.dbPath());
+
+	std::string names[2] = { "copied", "streamed" };
+	long allocs[2] = { 0, 0 };
+	long allocBytes[2] = { 0, 0 };
+	long peakBytes[2] = { 0, 0 };
+	qint64 nsecs[2] = { 0, 0 };
+
+	QElapsedTimer timer;
+	for (unsigned int i = 0; i < features.size(); i++) {
+		LayerRequest request(i, features[i], features[i]->_tableName,
+				opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+		// an empty query, to release the lists SpatiaLiteDB holds from the last one
+		LayerRequest nothing(i, features[i], features[i]->_tableName,
+				1000.0, 1000.0, 1001.0, 1001.0);
+		for (int m = 0; m < 2; m++) {
+			for (int r = 0; r < opts.repeats; r++) {
+				if (m == 0) {
+					MapLayer empty(i);
+					QMicroMapLoader::copyLayer(db, nothing, empty);
+				}
+#ifdef HEAP_ACCOUNTING
+				_allocs = _allocBytes = _liveBytes = _peakBytes = 0;
+				_counting = true;
+#endif
+				timer.start();
+				{
+					MapLayer layer(i);
+					if (m == 0) {
+						QMicroMapLoader::copyLayer(db, request, layer);
+					} else {
+						QMicroMapLoader::loadLayer(connection, request, layer);
+					}
+					nsecs[m] += timer.nsecsElapsed();
+#ifdef HEAP_ACCOUNTING
+					_counting = false;
+#endif
+				}
+#ifdef HEAP_ACCOUNTING
+				allocs[m] += _allocs;
+				allocBytes[m] += _allocBytes;
+				if (_peakBytes > peakBytes[m]) {
+					peakBytes[m] = _peakBytes;
+				}
+#endif
+			}
+		}
+	}
+
+	std::cout << features.size() << " features" << std::endl;
+	for (int m = 0; m < 2; m++) {
+		report(names[m], nsecs[m], opts.repeats);
+#ifdef HEAP_ACCOUNTING
+		std::cout << "  allocations  " << allocs[m] / opts.repeats << std::endl;
+		std::cout << "  allocated    " << std::setprecision(2)
+				<< (double)allocBytes[m] / opts.repeats / (1024.0 * 1024.0) << " MB" << std::endl;
+		std::cout << "  peak layer   " << std::setprecision(2)
+				<< (double)peakBytes[m] / (1024.0 * 1024.0) << " MB" << std::endl;
+#endif
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Compare the time to render a frame of the scene, when every polygon and
+/// linestring is its own item, against one item per layer. The frames are
+/// the whole map, followed by a window a quarter of the map wide panned from
+/// one side to the other.
+void benchFrame(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	const int PAN_STEPS = 16;
+
+	QImage image(1000, 800, QImage::Format_ARGB32_Premultiplied);
+
+	double w = (opts.xmax - opts.xmin) / 4.0;
+	double h = qMin(w * image.height() / image.width(), opts.ymax - opts.ymin);
+	double y = (opts.ymin + opts.ymax - h) / 2.0;
+
+	std::vector<QRectF> frames;
+	frames.push_back(QRectF(opts.xmin, opts.ymin, opts.xmax - opts.xmin, opts.ymax - opts.ymin));
+	for (int i = 0; i < PAN_STEPS; i++) {
+		double x = opts.xmin + (opts.xmax - opts.xmin - w) * i / (PAN_STEPS - 1);
+		frames.push_back(QRectF(x, y, w, h));
+	}
+
+	std::string names[2] = { "item per geometry", "item per layer" };
+	for (int m = 0; m < 2; m++) {
+		BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax,
+				QMicroMap::LOAD_SYNC, m == 1);
+		// scene->render() does not go through the view's background
+		map.setBackgroundCache(false);
+		QGraphicsScene* scene = map.scene();
+		std::cout << names[m] << ": " << scene->items().size() << " items" << std::endl;
+
+		QElapsedTimer timer;
+		timer.start();
+		for (int r = 0; r < opts.repeats; r++) {
+			for (unsigned int f = 0; f < frames.size(); f++) {
+				image.fill(Qt::white);
+				QPainter painter(&image);
+				painter.setRenderHints(map.renderHints());
+				scene->render(&painter, QRectF(image.rect()), frames[f], Qt::IgnoreAspectRatio);
+			}
+		}
+		report("  frame", timer.nsecsElapsed(), opts.repeats * frames.size());
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Compare the latency of hovering over station models placed on the map,
+/// with the map layers painted as scene items, against painting them into
+/// the cached view background. The mouse moves back and forth between two
+/// stations; each move repaints both of them, and whatever lies under them.
+void benchHover(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	const int STATIONS = 5000;
+	const int MOVES = 200;
+
+	std::string names[2] = { "scene items", "cached background" };
+	for (int m = 0; m < 2; m++) {
+		BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+		map.setBackgroundCache(m == 1);
+		map.setMouseMode(QMicroMap::MOUSE_SELECT);
+		map.resize(1000, 800);
+		map.show();
+
+		// a fixed pseudo random spread, the same for both runs
+		srand(1);
+		std::vector<QStationModelGraphicsItem*> stations;
+		for (int i = 0; i < STATIONS; i++) {
+			double x = opts.xmin + (opts.xmax - opts.xmin) * rand() / RAND_MAX;
+			double y = opts.ymin + (opts.ymax - opts.ymin) * rand() / RAND_MAX;
+			QStationModelGraphicsItem* station = new QStationModelGraphicsItem("bench",
+					x, y, 10.0 + i % 40, i % 360, 20.0, 10.0, 1013.0, true, 12, 0, 30);
+			map.scene()->addItem(station);
+			stations.push_back(station);
+		}
+
+		// settle the first paint, which fills the background cache
+		for (int i = 0; i < 10; i++) {
+			QApplication::processEvents();
+		}
+
+		QPoint p[2] = { map.mapFromScene(stations[0]->pos()),
+				map.mapFromScene(stations[1]->pos()) };
+
+		QElapsedTimer timer;
+		timer.start();
+		for (int r = 0; r < opts.repeats * MOVES; r++) {
+			QPoint pos = p[r % 2];
+			QMouseEvent move(QEvent::MouseMove, pos, map.viewport()->mapToGlobal(pos),
+					Qt::NoButton, Qt::NoButton, Qt::NoModifier);
+			QApplication::sendEvent(map.viewport(), &move);
+			map.viewport()->repaint();
+		}
+		std::cout << names[m] << ": " << map.scene()->items().size() << " items" << std::endl;
+		report("  hover", timer.nsecsElapsed(), opts.repeats * MOVES);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Compare the frame time of views less than 2 degrees across, on coasts
+/// where large country polygons cross the edge of the view, without and with
+/// paint time clipping. The first frame of each view, which makes the
+/// clipped parts, is reported separately from the repeats, which reuse them.
+void benchClip(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	// centre longitude, latitude and span, in degrees
+	const double views[][3] = {
+			{ -70.2,  43.6, 1.5 },   // Maine
+			{ -123.4, 48.4, 1.0 },   // Vancouver Island
+			{ -5.6,   36.0, 0.5 },   // Strait of Gibraltar
+			{ 151.2, -33.9, 1.0 },   // Sydney
+			{ 39.7,   64.5, 1.8 },   // White Sea
+			{ -64.0,  48.5, 0.25 },  // Gaspe
+	};
+	const int VIEWS = sizeof(views) / sizeof(views[0]);
+
+	BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+	// paint the layers on every frame, rather than from the background cache
+	map.setBackgroundCache(false);
+	map.resize(1000, 800);
+	map.show();
+	QApplication::processEvents();
+
+	std::string names[2] = { "unclipped", "clipped" };
+	qint64 first[2] = { 0, 0 };
+	qint64 nsecs[2] = { 0, 0 };
+	for (int v = 0; v < VIEWS; v++) {
+		double span = views[v][2];
+		map.zoomTo(QRectF(views[v][0] - span / 2.0, views[v][1] - span / 2.0, span, span));
+		QApplication::processEvents();
+
+		for (int m = 0; m < 2; m++) {
+			map.setClipping(m == 1);
+
+			QElapsedTimer timer;
+			timer.start();
+			map.viewport()->repaint();
+			first[m] += timer.nsecsElapsed();
+
+			timer.start();
+			for (int r = 0; r < opts.repeats; r++) {
+				map.viewport()->repaint();
+			}
+			nsecs[m] += timer.nsecsElapsed();
+		}
+	}
+
+	for (int m = 0; m < 2; m++) {
+		std::cout << names[m] << std::endl;
+		report("  first frame", first[m], VIEWS);
+		report("  frame", nsecs[m], VIEWS * opts.repeats);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Compare the frame time of the whole map and of continental views,
+/// painting every vertex against painting the decimated layers, and count
+/// the pixels which differ between the two.
+void benchDecimate(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	std::vector<QRectF> views;
+	views.push_back(QRectF(opts.xmin, opts.ymin, opts.xmax - opts.xmin, opts.ymax - opts.ymin));
+	views.push_back(QRectF(-130.0, 20.0, 70.0, 35.0));   // North America
+	views.push_back(QRectF(-12.0, 35.0, 50.0, 30.0));    // Europe
+	views.push_back(QRectF(95.0, -12.0, 60.0, 35.0));    // South East Asia
+
+	BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+	map.setBackgroundCache(false);
+	map.resize(1000, 800);
+	map.show();
+	QApplication::processEvents();
+
+	std::string names[2] = { "every vertex", "decimated" };
+	qint64 nsecs[2] = { 0, 0 };
+	long differ = 0;
+	long pixels = 0;
+	for (unsigned int v = 0; v < views.size(); v++) {
+		map.zoomTo(views[v]);
+		QApplication::processEvents();
+
+		QImage frames[2];
+		for (int m = 0; m < 2; m++) {
+			map.setDecimation(m == 1 ? 0.5 : 0.0);
+			// the first paint makes the decimated level
+			map.viewport()->repaint();
+
+			QElapsedTimer timer;
+			timer.start();
+			for (int r = 0; r < opts.repeats; r++) {
+				map.viewport()->repaint();
+			}
+			nsecs[m] += timer.nsecsElapsed();
+			frames[m] = map.viewport()->grab().toImage();
+		}
+
+		for (int y = 0; y < frames[0].height(); y++) {
+			const QRgb* a = (const QRgb*)frames[0].constScanLine(y);
+			const QRgb* b = (const QRgb*)frames[1].constScanLine(y);
+			for (int x = 0; x < frames[0].width(); x++) {
+				if (a[x] != b[x]) {
+					differ++;
+				}
+			}
+		}
+		pixels += frames[0].width() * frames[0].height();
+	}
+
+	for (int m = 0; m < 2; m++) {
+		std::cout << names[m] << std::endl;
+		report("  frame", nsecs[m], views.size() * opts.repeats);
+	}
+	std::cout << "pixels changed  " << std::setprecision(3)
+			<< 100.0 * differ / pixels << " %" << std::endl;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Measure the rate at which each PointTransform kernel that the processor
+/// supports maps points through the view transform, and check that they
+/// agree with the scalar kernel.
+void benchTransform(BenchOptions& opts) {
+
+	const int POINTS = 1 << 20;
+	const int PASSES = 20;
+
+	// a 1000 pixel wide view of the map, y up, as QMicroMap sets it up
+	double scale = 1000.0 / (opts.xmax - opts.xmin);
+	QTransform transform(scale, 0.0, 0.0, -scale, -opts.xmin * scale, opts.ymax * scale);
+	PointTransform device(transform);
+
+	srand(1);
+	QVector<QPointF> points(POINTS);
+	for (int i = 0; i < POINTS; i++) {
+		points[i] = QPointF(opts.xmin + (opts.xmax - opts.xmin) * rand() / RAND_MAX,
+				opts.ymin + (opts.ymax - opts.ymin) * rand() / RAND_MAX);
+	}
+
+	QVector<QPoint> reference(POINTS);
+	device.map(points.constData(), POINTS, reference.data(), PointTransform::ISA_SCALAR);
+
+	QVector<QPoint> mapped(POINTS);
+	PointTransform::ISA isas[3] = { PointTransform::ISA_SCALAR, PointTransform::ISA_SSE2,
+			PointTransform::ISA_AVX2 };
+	for (int k = 0; k < 3; k++) {
+		if (!PointTransform::supported(isas[k])) {
+			std::cout << std::setw(32) << std::left << PointTransform::name(isas[k])
+					<< "not supported" << std::endl;
+			continue;
+		}
+
+		QElapsedTimer timer;
+		timer.start();
+		for (int r = 0; r < opts.repeats * PASSES; r++) {
+			device.map(points.constData(), POINTS, mapped.data(), isas[k]);
+		}
+		qint64 nsecs = timer.nsecsElapsed();
+
+		int differ = 0;
+		for (int i = 0; i < POINTS; i++) {
+			if (mapped[i] != reference[i]) {
+				differ++;
+			}
+		}
+
+		double rate = (double)POINTS * opts.repeats * PASSES / (nsecs / 1.0e9);
+		std::cout << std::setw(32) << std::left << PointTransform::name(isas[k])
+				<< std::setw(10) << std::right << std::fixed << std::setprecision(1)
+				<< rate / 1.0e6 << " Mpoints/s";
+		if (differ) {
+			std::cout << "  " << differ << " differ from scalar";
+		}
+		std::cout << std::endl;
+	}
+	std::cout << "chosen at run time: " << PointTransform::name(PointTransform::bestISA()) << std::endl;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Compare the frame time of painting the layers' items against replaying
+/// their display lists, with an item per geometry and with an item per layer.
+/// The frames are the whole map and three continental views.
+void benchPicture(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	std::vector<QRectF> views;
+	views.push_back(QRectF(opts.xmin, opts.ymin, opts.xmax - opts.xmin, opts.ymax - opts.ymin));
+	views.push_back(QRectF(-130.0, 20.0, 70.0, 35.0));
+	views.push_back(QRectF(-12.0, 35.0, 50.0, 30.0));
+	views.push_back(QRectF(95.0, -12.0, 60.0, 35.0));
+
+	std::string batches[2] = { "item per geometry", "item per layer" };
+	std::string names[2] = { "  scene items", "  display lists" };
+	for (int b = 0; b < 2; b++) {
+		BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax,
+				QMicroMap::LOAD_SYNC, b == 1);
+		map.setBackgroundCache(false);
+		map.resize(1000, 800);
+		map.show();
+		QApplication::processEvents();
+		std::cout << batches[b] << std::endl;
+
+		qint64 nsecs[2] = { 0, 0 };
+		for (unsigned int v = 0; v < views.size(); v++) {
+			map.zoomTo(views[v]);
+			QApplication::processEvents();
+			for (int m = 0; m < 2; m++) {
+				// the recording is not timed
+				map.setDisplayLists(m == 1);
+				map.viewport()->repaint();
+
+				QElapsedTimer timer;
+				timer.start();
+				for (int r = 0; r < opts.repeats; r++) {
+					map.viewport()->repaint();
+				}
+				nsecs[m] += timer.nsecsElapsed();
+			}
+		}
+		for (int m = 0; m < 2; m++) {
+			report(names[m], nsecs[m], views.size() * opts.repeats);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Report the frame rate of a scripted drag in MOUSE_PAN: at full quality,
+/// at interactive quality, and at interactive quality with the labels and
+/// the detail layers hidden. The map is zoomed into North America, and
+/// dragged back and forth, painting after every mouse move.
+void benchDrag(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	const int STEPS = 100;
+	const int STEP_PIXELS = 4;
+
+	std::string names[3] = { "full quality", "interactive", "interactive, hiding" };
+	for (int m = 0; m < 3; m++) {
+		BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+		map.setInteractiveQuality(m > 0, m == 2 ? QMicroMap::HIDE_LABELS | QMicroMap::HIDE_DETAIL : 0);
+		map.resize(1000, 800);
+		map.show();
+		QApplication::processEvents();
+		map.zoomTo(QRectF(-130.0, 20.0, 70.0, 35.0));
+		map.setMouseMode(QMicroMap::MOUSE_PAN);
+		QApplication::processEvents();
+
+		QWidget* viewport = map.viewport();
+		QPoint pos(viewport->width() / 2, viewport->height() / 2);
+
+		int frames = 0;
+		QElapsedTimer timer;
+		timer.start();
+		for (int r = 0; r < opts.repeats; r++) {
+			QMouseEvent press(QEvent::MouseButtonPress, pos, viewport->mapToGlobal(pos),
+					Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+			QApplication::sendEvent(viewport, &press);
+			for (int s = 0; s < STEPS; s++) {
+				// out and back, so the map ends where it started
+				pos.rx() += s < STEPS / 2 ? STEP_PIXELS : -STEP_PIXELS;
+				QMouseEvent move(QEvent::MouseMove, pos, viewport->mapToGlobal(pos),
+						Qt::NoButton, Qt::LeftButton, Qt::NoModifier);
+				QApplication::sendEvent(viewport, &move);
+				viewport->repaint();
+				frames++;
+			}
+			QMouseEvent release(QEvent::MouseButtonRelease, pos, viewport->mapToGlobal(pos),
+					Qt::LeftButton, Qt::NoButton, Qt::NoModifier);
+			QApplication::sendEvent(viewport, &release);
+			QApplication::processEvents();
+		}
+		qint64 nsecs = timer.nsecsElapsed();
+
+		std::cout << std::setw(32) << std::left << names[m]
+				<< std::setw(10) << std::right << std::fixed << std::setprecision(1)
+				<< frames / (nsecs / 1.0e9) << " fps" << std::endl;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// A layer's geometry, copied for drawing tiles.
+struct RasterLayer {
+	bool polygons;
+	QPen pen;
+	QBrush brush;
+	QVector<QPointF> vertices;
+	QVector<quint32> partStart;
+	QVector<double> partBoxes;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Draw one tile, as TilePyramidItem does.
+/// @param image The tile, cleared to transparent.
+/// @param rect The tile's area, in scene coordinates.
+/// @param layers The layers.
+/// @param method 0 for QPainter with antialiasing, 1 for QPainter without, 2 for the TileRasterizer.
+/// @param rasterizer The rasterizer, reused between tiles.
+void drawRasterTile(QImage& image, const QRectF& rect, const std::vector<RasterLayer>& layers,
+		int method, TileRasterizer& rasterizer) {
+
+	if (method == 2) {
+		rasterizer.begin(&image, rect);
+		for (unsigned int i = 0; i < layers.size(); i++) {
+			const RasterLayer& layer = layers[i];
+			rasterizer.drawParts(layer.polygons, layer.vertices.constData(),
+					layer.partStart.constData(), layer.partBoxes.constData(),
+					layer.partStart.size() - 1, layer.pen, layer.brush);
+		}
+		return;
+	}
+
+	QPainter painter(&image);
+	painter.setRenderHint(QPainter::Antialiasing, method == 0);
+	double scale = image.width() / rect.width();
+	painter.scale(scale, scale);
+	painter.translate(-rect.left(), -rect.top());
+	for (unsigned int i = 0; i < layers.size(); i++) {
+		const RasterLayer& layer = layers[i];
+		painter.setPen(layer.pen);
+		painter.setBrush(layer.brush);
+		LayerItem::drawParts(&painter, rect, layer.polygons, layer.vertices.constData(),
+				layer.partStart.constData(), layer.partBoxes.constData(),
+				layer.partStart.size() - 1);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Report the rate at which base map tiles are drawn with QPainter, with
+/// and without antialiasing, and with the TileRasterizer, over pyramid
+/// levels 0 to 3. The TileRasterizer's tiles are then compared with the
+/// antialiased ones, which TilePyramidItem draws by default. The rasterizer
+/// does not antialias, so a pixel only counts as different when a channel is
+/// further off than an edge pixel can be.
+/// @return 1 if too many pixels differ, otherwise 0.
+int benchRaster(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	const int TILE = 256;
+	const int LEVELS = 4;
+	// the largest channel difference allowed for an edge pixel
+	const int CHANNEL_TOLERANCE = 160;
+	// the largest fraction of the pixels allowed to differ
+	const double MAX_DIFFERING = 0.01;
+
+	BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+	std::vector<RasterLayer> layers;
+	QList<QGraphicsItem*> items = map.scene()->items(Qt::AscendingOrder);
+	for (int i = 0; i < items.size(); i++) {
+		LayerItem* item = dynamic_cast<LayerItem*>(items[i]);
+		if (!item || !TileRasterizer::canDraw(item->pen(), item->brush())) {
+			continue;
+		}
+		RasterLayer layer;
+		layer.polygons = item->polygons();
+		layer.pen = item->pen();
+		layer.brush = item->brush();
+		item->copyParts(layer.vertices, layer.partStart, layer.partBoxes);
+		layers.push_back(layer);
+	}
+
+	// square tiles, 2^level across the map
+	std::vector<QRectF> tiles;
+	for (int level = 0; level < LEVELS; level++) {
+		double size = (opts.xmax - opts.xmin) / (1 << level);
+		for (double y = opts.ymin; y < opts.ymax; y += size) {
+			for (double x = opts.xmin; x < opts.xmax; x += size) {
+				tiles.push_back(QRectF(x, y, size, size));
+			}
+		}
+	}
+
+	std::string names[3] = { "QPainter, antialiased", "QPainter", "TileRasterizer" };
+	TileRasterizer rasterizer;
+	QImage image(TILE, TILE, QImage::Format_ARGB32_Premultiplied);
+	QImage reference(TILE, TILE, QImage::Format_ARGB32_Premultiplied);
+	for (int m = 0; m < 3; m++) {
+		QElapsedTimer timer;
+		timer.start();
+		for (int r = 0; r < opts.repeats; r++) {
+			for (unsigned int t = 0; t < tiles.size(); t++) {
+				image.fill(Qt::transparent);
+				drawRasterTile(image, tiles[t], layers, m, rasterizer);
+			}
+		}
+		qint64 nsecs = timer.nsecsElapsed();
+		std::cout << std::setw(32) << std::left << names[m]
+				<< std::setw(10) << std::right << std::fixed << std::setprecision(1)
+				<< tiles.size() * opts.repeats / (nsecs / 1.0e9) << " tiles/s" << std::endl;
+	}
+
+	long differ = 0;
+	long pixels = 0;
+	for (unsigned int t = 0; t < tiles.size(); t++) {
+		image.fill(Qt::transparent);
+		reference.fill(Qt::transparent);
+		drawRasterTile(image, tiles[t], layers, 2, rasterizer);
+		drawRasterTile(reference, tiles[t], layers, 0, rasterizer);
+		for (int y = 0; y < TILE; y++) {
+			const uchar* a = image.constScanLine(y);
+			const uchar* b = reference.constScanLine(y);
+			for (int x = 0; x < 4 * TILE; x += 4) {
+				for (int c = 0; c < 4; c++) {
+					if (abs(a[x+c] - b[x+c]) > CHANNEL_TOLERANCE) {
+						differ++;
+						break;
+					}
+				}
+			}
+		}
+		pixels += TILE * TILE;
+	}
+	double fraction = (double)differ / pixels;
+	std::cout << "pixels differing from QPainter  " << std::setprecision(3)
+			<< 100.0 * fraction << " % (at most " << 100.0 * MAX_DIFFERING << " %)" << std::endl;
+	if (fraction > MAX_DIFFERING) {
+		std::cout << "TileRasterizer differs from the antialiased QPainter tiles" << std::endl;
+		return 1;
+	}
+	return 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @return The items in a scene, as a set. QList::toSet() is deprecated.
+/// @param scene The scene.
+QSet<QGraphicsItem*> itemSet(QGraphicsScene* scene) {
+
+	QList<QGraphicsItem*> items = scene->items();
+	QSet<QGraphicsItem*> set;
+	set.reserve(items.size());
+	for (int i = 0; i < items.size(); i++) {
+		set.insert(items[i]);
+	}
+	return set;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Zoom in and out through a sequence of views with the grid on, timing
+/// the zoom and the paint after it, and count the scene items which were
+/// created or deleted along the way.
+void benchGrid(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	std::vector<QRectF> views;
+	views.push_back(QRectF(opts.xmin, opts.ymin, opts.xmax - opts.xmin, opts.ymax - opts.ymin));
+	views.push_back(QRectF(-130.0, 20.0, 70.0, 35.0));
+	views.push_back(QRectF(-110.0, 35.0, 10.0, 5.0));
+	views.push_back(QRectF(-106.0, 39.0, 2.0, 1.0));
+
+	BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+	map.setBackgroundCache(false);
+	map.grid(true);
+	map.resize(1000, 800);
+	map.show();
+	QApplication::processEvents();
+
+	QSet<QGraphicsItem*> items = itemSet(map.scene());
+	int created = 0;
+	qint64 nsecs = 0;
+	for (int r = 0; r < opts.repeats; r++) {
+		for (unsigned int v = 0; v < views.size(); v++) {
+			QElapsedTimer timer;
+			timer.start();
+			map.zoomTo(views[v]);
+			map.drawGrid(views[v]);
+			map.viewport()->repaint();
+			nsecs += timer.nsecsElapsed();
+
+			// not timed
+			QSet<QGraphicsItem*> now = itemSet(map.scene());
+			created += QSet<QGraphicsItem*>(now).subtract(items).size();
+			items = now;
+		}
+	}
+	report("zoom", nsecs, views.size() * opts.repeats);
+	std::cout << "scene items created  " << created << std::endl;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Change the four corner annotations and a free one, and repaint, as a
+/// clock or a cursor readout would, and report the frame time. The scene
+/// item count is checked before and after.
+void benchAnnotate(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	const int FRAMES = 100;
+
+	BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+	map.resize(1000, 800);
+	map.show();
+	QApplication::processEvents();
+
+	int items = map.scene()->items().size();
+	QElapsedTimer timer;
+	timer.start();
+	for (int f = 0; f < FRAMES * opts.repeats; f++) {
+		QString text = QString("frame %1").arg(f);
+		map.beginUpdate();
+		map.setAnnotation(QMicroMap::CORNER_TOP_LEFT, text);
+		map.setAnnotation(QMicroMap::CORNER_TOP_RIGHT, text);
+		map.setAnnotation(QMicroMap::CORNER_BOTTOM_LEFT, text);
+		map.setAnnotation(QMicroMap::CORNER_BOTTOM_RIGHT, text);
+		map.setAnnotation("cursor", QPoint(500, 400), text);
+		map.endUpdate();
+		map.viewport()->repaint();
+	}
+	report("frame", timer.nsecsElapsed(), FRAMES * opts.repeats);
+	std::cout << "scene items added  " << map.scene()->items().size() - items << std::endl;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Send a mouse button press and release to the map.
+/// @param map The map.
+/// @param button The button.
+/// @param from Where it is pressed.
+/// @param to Where it is released.
+void click(QMicroMap& map, Qt::MouseButton button, QPoint from, QPoint to) {
+
+	QWidget* viewport = map.viewport();
+	QMouseEvent press(QEvent::MouseButtonPress, from, viewport->mapToGlobal(from),
+			button, button, Qt::NoModifier);
+	QApplication::sendEvent(viewport, &press);
+	QMouseEvent move(QEvent::MouseMove, to, viewport->mapToGlobal(to),
+			Qt::NoButton, button, Qt::NoModifier);
+	QApplication::sendEvent(viewport, &move);
+	QMouseEvent release(QEvent::MouseButtonRelease, to, viewport->mapToGlobal(to),
+			button, Qt::NoButton, Qt::NoModifier);
+	QApplication::sendEvent(viewport, &release);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Zoom in with the rubber band, and back out with the right button, timing
+/// the zoom back to its first frame, without and with the zoom snapshots.
+/// With the snapshots, the time until the view is refreshed is reported too.
+void benchZoomBack(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	std::string names[2] = { "no snapshots", "snapshots" };
+	for (int m = 0; m < 2; m++) {
+		BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+		map.setZoomFrames(m == 1 ? 64 * 1024 * 1024 : 0);
+		map.setMouseMode(QMicroMap::MOUSE_ZOOM);
+		map.resize(1000, 800);
+		map.show();
+		QApplication::processEvents();
+		std::cout << names[m] << std::endl;
+
+		qint64 first = 0;
+		qint64 refreshed = 0;
+		for (int r = 0; r < opts.repeats; r++) {
+			// not timed
+			click(map, Qt::LeftButton, QPoint(300, 250), QPoint(700, 550));
+			QApplication::processEvents();
+			map.viewport()->repaint();
+			QApplication::processEvents();
+
+			QElapsedTimer timer;
+			timer.start();
+			click(map, Qt::RightButton, QPoint(500, 400), QPoint(500, 400));
+			// the scheduled redraw, if the zoom is not waiting for the idle timer
+			QApplication::processEvents();
+			map.viewport()->repaint();
+			first += timer.nsecsElapsed();
+
+			// the idle timer replaces the snapshot
+			while (map.showingZoomFrame()) {
+				QApplication::processEvents(QEventLoop::WaitForMoreEvents);
+			}
+			QApplication::processEvents();
+			map.viewport()->repaint();
+			refreshed += timer.nsecsElapsed();
+		}
+		report("  first frame", first, opts.repeats);
+		if (m == 1) {
+			report("  refreshed", refreshed, opts.repeats);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Count the paint events of a widget.
+class PaintCounter: public QObject {
+public:
+	PaintCounter(): _paints(0) {}
+	virtual bool eventFilter(QObject* /*object*/, QEvent* event) {
+		if (event->type() == QEvent::Paint) {
+			_paints++;
+		}
+		return false;
+	}
+	int _paints;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Grow and shrink the window in small steps, letting it paint after each,
+/// as a live resize does, and report the paint calls per second, without
+/// and with the stretched preview. The final exact paint, after the idle
+/// timer, is not included.
+void benchResize(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	const int STEPS = 100;
+	const int STEP_PIXELS = 4;
+
+	std::string names[2] = { "repaint the scene", "stretched preview" };
+	for (int m = 0; m < 2; m++) {
+		BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+		map.setResizePreview(m == 1);
+		map.resize(1000, 800);
+		map.show();
+		QApplication::processEvents();
+
+		PaintCounter counter;
+		map.viewport()->installEventFilter(&counter);
+
+		QSize size = map.size();
+		qint64 nsecs = 0;
+		for (int r = 0; r < opts.repeats; r++) {
+			QElapsedTimer timer;
+			timer.start();
+			for (int s = 0; s < STEPS; s++) {
+				// out and back, so the window ends the size it started
+				int d = s < STEPS / 2 ? STEP_PIXELS : -STEP_PIXELS;
+				size += QSize(d, d);
+				map.resize(size);
+				QApplication::processEvents();
+			}
+			nsecs += timer.nsecsElapsed();
+
+			// not timed or counted: the idle timer fits the map to the window
+			int paints = counter._paints;
+			QElapsedTimer settle;
+			settle.start();
+			while (settle.elapsed() < 200) {
+				QApplication::processEvents();
+			}
+			counter._paints = paints;
+		}
+		map.viewport()->removeEventFilter(&counter);
+
+		std::cout << std::setw(32) << std::left << names[m]
+				<< std::setw(10) << std::right << std::fixed << std::setprecision(1)
+				<< counter._paints / (nsecs / 1.0e9) << " paints/s" << std::endl;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// Time animation steps which each set the level name and timestamp
+/// annotations, and the level of detail tolerance, several times. Every
+/// change is either redrawn at once, as the setters used to do, or all are
+/// folded into one redraw by beginUpdate() and endUpdate().
+void benchCoalesce(SpatiaLiteDB& db, BenchOptions& opts) {
+
+	const int STEPS = 100;
+	const int CHANGES = 5;
+
+	std::string names[2] = { "redraw every change", "redraw once per step" };
+	for (int m = 0; m < 2; m++) {
+		BenchMap map(db, opts.xmin, opts.ymin, opts.xmax, opts.ymax);
+		map.resize(1000, 800);
+		map.show();
+		QApplication::processEvents();
+
+		QElapsedTimer timer;
+		timer.start();
+		for (int step = 0; step < STEPS * opts.repeats; step++) {
+			if (m == 1) {
+				map.beginUpdate();
+			}
+			for (int c = 0; c < CHANGES; c++) {
+				// endUpdate() redraws at once, as each setter used to
+				if (m == 0) {
+					map.beginUpdate();
+				}
+				map.setTopLeftAnnotation(QString("level %1").arg(c));
+				if (m == 0) {
+					map.endUpdate();
+					map.beginUpdate();
+				}
+				map.setTopRightAnnotation(QString("step %1.%2").arg(step).arg(c));
+				if (m == 0) {
+					map.endUpdate();
+					map.beginUpdate();
+				}
+				map.setLodPixelTolerance(1.0 + c % 2);
+				if (m == 0) {
+					map.endUpdate();
+				}
+			}
+			if (m == 1) {
+				map.endUpdate();
+			}
+			map.viewport()->repaint();
+		}
+		report(names[m], timer.nsecsElapsed(), STEPS * opts.repeats);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv) {
+
+	// Create the Qt application
+	QApplication app(argc, argv);
+
+	BenchOptions opts;
+	opts.xmin = -180.0;
+	opts.ymin =  -90.0;
+	opts.xmax =  180.0;
+	opts.ymax =   90.0;
+	opts.repeats = 3;
+	opts.threads = 0;
+
+	getOptions(argc, argv, opts);
+
+	try {
+		SpatiaLiteDB db(opts.dbPath);
+
+		if (opts.test == "load") {
+			benchLoad(db, opts);
+		} else if (opts.test == "stream") {
+			benchStream(db, opts);
+		} else if (opts.test == "frame") {
+			benchFrame(db, opts);
+		} else if (opts.test == "hover") {
+			benchHover(db, opts);
+		} else if (opts.test == "clip") {
+			benchClip(db, opts);
+		} else if (opts.test == "decimate") {
+			benchDecimate(db, opts);
+		} else if (opts.test == "transform") {
+			benchTransform(opts);
+		} else if (opts.test == "picture") {
+			benchPicture(db, opts);
+		} else if (opts.test == "drag") {
+			benchDrag(db, opts);
+		} else if (opts.test == "raster") {
+			if (benchRaster(db, opts)) {
+				return 1;
+			}
+		} else if (opts.test == "grid") {
+			benchGrid(db, opts);
+		} else if (opts.test == "annotate") {
+			benchAnnotate(db, opts);
+		} else if (opts.test == "zoomback") {
+			benchZoomBack(db, opts);
+		} else if (opts.test == "resize") {
+			benchResize(db, opts);
+		} else if (opts.test == "coalesce") {
+			benchCoalesce(db, opts);
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	} catch (std::runtime_error& error) {
+		std::cout << error.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
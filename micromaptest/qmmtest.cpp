@@ -6,10 +6,30 @@
  */
 
 #include <unistd.h>
+#include <stdio.h>
 #include <iostream>
 #include <string>
 #include <vector>
+#include <QtCore/QElapsedTimer>
 #include "QMicroMapTest.h"
+#include "GeometryCache.h"
+
+/////////////////////////////////////////////////////////////////////////////////////////////////
+/// @return The resident set size of the process, in megabytes, or -1 if
+/// it is not available.
+double residentMB() {
+	double mb = -1.0;
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm) {
+		long size;
+		long resident;
+		if (fscanf(statm, "%ld %ld", &size, &resident) == 2) {
+			mb = (double)resident * sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+		}
+		fclose(statm);
+	}
+	return mb;
+}
 
 /////////////////////////////////////////////////////////////////////////////////////////////////
 void options(int argc, char**argv,
@@ -17,14 +37,24 @@ void options(int argc, char**argv,
 		double& xmin,
 		double& xmax,
 		double& ymin,
-		double& ymax) {
+		double& ymax,
+		QMicroMap::LOAD_MODE& loadMode,
+		qint64& memoryBudget,
+		bool& exportCache,
+		bool& timeStartup,
+		std::vector<MapDatabase>& detail,
+		bool& rasterTiles,
+		bool& tileStore) {
 
 	extern char *optarg;
 	int opt;
 	bool err = false;
 
-	while ((opt = getopt(argc, argv, "b:d:")) != -1) {
+	while ((opt = getopt(argc, argv, "ab:d:f:m:prstx")) != -1) {
 		switch (opt) {
+		case 'a':
+			loadMode = QMicroMap::LOAD_ASYNC;
+			break;
 		case 'b': {
 			std::string arg(optarg);
 			std::vector<std::string> tokens;
@@ -50,6 +80,37 @@ void options(int argc, char**argv,
 		case 'd':
 			dbpath = std::string(optarg);
 			break;
+		case 'f': {
+			// a more detailed database, and the largest view it is used for
+			std::string arg(optarg);
+			std::string::size_type comma = arg.rfind(',');
+			if (comma == std::string::npos) {
+				err = true;
+				break;
+			}
+			detail.push_back(MapDatabase(arg.substr(0, comma), atof(arg.substr(comma + 1).c_str())));
+			break;
+		}
+		case 'm':
+			// megabytes
+			memoryBudget = (qint64)(atof(optarg) * 1024 * 1024);
+			break;
+		case 'p':
+			loadMode = QMicroMap::LOAD_PARALLEL;
+			break;
+		case 'r':
+			rasterTiles = true;
+			break;
+		case 's':
+			rasterTiles = true;
+			tileStore = true;
+			break;
+		case 't':
+			timeStartup = true;
+			break;
+		case 'x':
+			exportCache = true;
+			break;
 		default:
 			err = true;
 			break;
@@ -61,7 +122,12 @@ void options(int argc, char**argv,
 	}
 
 	if (err) {
-		std::cerr <<"usage: " << argv[0] << " -d db_path [-b xmin,ymin,xmax,ymax] [qt args]" << std::endl;
+		std::cerr <<"usage: " << argv[0] << " -d db_path [-b xmin,ymin,xmax,ymax] [-a | -p] [-f detail_db_path,max_span ...] [-m memory_budget_MB] [-r | -s] [-t] [-x] [qt args]" << std::endl;
+		std::cerr << "  -f  draw from a more detailed database when the view is no wider than max_span degrees" << std::endl;
+		std::cerr << "  -r  draw the map from raster tiles, rendered in worker threads" << std::endl;
+		std::cerr << "  -s  the same, keeping the tiles on disk for later runs" << std::endl;
+		std::cerr << "  -t  report the startup time and resident memory" << std::endl;
+		std::cerr << "  -x  write the geometry cache for the database, and exit" << std::endl;
 		exit(1);
 	}
 }
@@ -74,6 +140,13 @@ int main(int argc, char** argv) {
 	double ymin =  -90.0;
 	double xmax = 180.0;
 	double ymax =  90.0;
+	QMicroMap::LOAD_MODE loadMode = QMicroMap::LOAD_SYNC;
+	qint64 memoryBudget = 0;
+	bool exportCache = false;
+	bool timeStartup = false;
+	std::vector<MapDatabase> detail;
+	bool rasterTiles = false;
+	bool tileStore = false;
 
 #if defined(Q_WS_X11)
 	// use the qt raster sstem on X11, otherwise the
@@ -85,18 +158,46 @@ int main(int argc, char** argv) {
 	QApplication app(argc, argv);
 
 	// get the options
-	options(argc, argv, dbpath, xmin, ymin, xmax, ymax);
+	options(argc, argv, dbpath, xmin, ymin, xmax, ymax, loadMode, memoryBudget, exportCache, timeStartup, detail, rasterTiles, tileStore);
 
 	// get the database
 	SpatiaLiteDB db(dbpath);
 
-	QMicroMapTest map(db, xmin, ymin, xmax, ymax, "lightblue");
+	if (exportCache) {
+		QMicroMap map(db, xmin, ymin, xmax, ymax);
+		if (!map.exportGeometryCache()) {
+			return 1;
+		}
+		std::cout << "wrote " << GeometryCache::cachePath(dbpath) << std::endl;
+		return 0;
+	}
+
+	double startRSS = residentMB();
+	QElapsedTimer timer;
+	timer.start();
+
+	QMicroMapTest map(db, xmin, ymin, xmax, ymax, "lightblue", 0, loadMode, memoryBudget);
+	for (unsigned int i = 0; i < detail.size(); i++) {
+		map.addDatabase(detail[i]._dbPath, detail[i]._maxSpan);
+	}
+	if (tileStore) {
+		map.setTileStore();
+	}
+	map.setRasterTiles(rasterTiles);
 	map.resize(1000,800);
 
 	map.setWindowTitle(dbpath.c_str());
 
 	map.show();
 
+	if (timeStartup) {
+		// the first paint
+		app.processEvents();
+		std::cout << "startup " << (map.usesGeometryCache() ? "with" : "without") << " geometry cache: "
+				<< timer.elapsed() << " ms, resident "
+				<< residentMB() << " MB (" << startRSS << " MB before the map)" << std::endl;
+	}
+
 	return app.exec();
 
 }
@@ -0,0 +1,211 @@
+/*
+ * mapcompile.cpp
+ *
+ * Build precomputed level of detail tables for QMicroMap.
+ *
+ * For each line and polygon table in a SpatiaLite database, simplified
+ * copies are written at a series of tolerances, named <table>__lod0
+ * (the coarsest) through <table>__lod<n-1> (the finest). Each copy is
+ * registered as a geometry table and given an R*Tree spatial index.
+ * The qmicromap_lod table records the copies and their tolerances, and
+ * is used by QMicroMap to choose a table for the current zoom level.
+ *
+ * The database is modified in place.
+ */
+
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "SpatiaLiteConnection.h"
+
+// Each level doubles the tolerance, so more than this is never useful.
+static const int MAX_LEVELS = 20;
+
+////////////////////////////////////////////////////////////////
+void usage(char* argv0) {
+	std::cout << "usage: " << argv0
+			<< "\n -d <spatialite database path>"
+			<< "\n [-l <number of levels, 1 to " << MAX_LEVELS << ", default 5>]"
+			<< "\n [-t <finest tolerance in degrees, default 0.01>]"
+			<< "\n [-T <table>] (may be repeated; default all line and polygon tables)"
+			<< std::endl;
+}
+
+////////////////////////////////////////////////////////////////
+void getOptions(int argc, char** argv, std::string &dbPath, int& levels,
+		double& tolerance, std::vector<std::string>& tables) {
+
+	extern char *optarg;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "d:l:t:T:")) != -1) {
+		switch (opt) {
+		case 'd':
+			dbPath = optarg;
+			break;
+		case 'l':
+			levels = atoi(optarg);
+			break;
+		case 't':
+			tolerance = atof(optarg);
+			break;
+		case 'T':
+			tables.push_back(optarg);
+			break;
+		default:
+			usage(argv[0]);
+			exit(1);
+		}
+	}
+
+	if (dbPath == "" || levels < 1 || levels > MAX_LEVELS || tolerance <= 0.0) {
+		usage(argv[0]);
+		exit(1);
+	}
+}
+
+////////////////////////////////////////////////////////////////
+/// Remove a level of detail table, its spatial index and its registration.
+void dropLod(SpatiaLiteConnection& db, std::string lodTable, std::string geomColumn) {
+
+	std::string idx = "idx_" + lodTable + "_" + geomColumn;
+
+	db.exec("DELETE FROM geometry_columns WHERE lower(f_table_name) = lower("
+			+ SpatiaLiteConnection::quote(lodTable) + ")");
+	db.exec("DROP TABLE IF EXISTS \"" + idx + "\"");
+	db.exec("DROP TABLE IF EXISTS \"" + lodTable + "\"");
+	db.exec("DELETE FROM qmicromap_lod WHERE lod_table = "
+			+ SpatiaLiteConnection::quote(lodTable));
+}
+
+////////////////////////////////////////////////////////////////
+/// Create one simplified copy of a table.
+void makeLod(SpatiaLiteConnection& db, std::string table, std::string geomColumn,
+		int level, double tolerance) {
+
+	std::ostringstream name;
+	name << table << "__lod" << level;
+	std::string lodTable = name.str();
+
+	std::ostringstream tol;
+	tol << std::setprecision(17) << tolerance;
+
+	std::ostringstream lvl;
+	lvl << level;
+
+	dropLod(db, lodTable, geomColumn);
+
+	db.exec("CREATE TABLE \"" + lodTable + "\" AS SELECT * FROM \"" + table + "\"");
+	db.exec("UPDATE \"" + lodTable + "\" SET \"" + geomColumn + "\" = SimplifyPreserveTopology(\""
+			+ geomColumn + "\", " + tol.str() + ")");
+	// features smaller than the tolerance collapse to nothing
+	db.exec("DELETE FROM \"" + lodTable + "\" WHERE \"" + geomColumn + "\" IS NULL");
+
+	// Register the copy with the same metadata as the original. Copying the
+	// row keeps this independent of the geometry_columns layout, which differs
+	// between SpatiaLite versions.
+	db.exec("DROP TABLE IF EXISTS temp.qmicromap_gc");
+	db.exec("CREATE TEMP TABLE qmicromap_gc AS SELECT * FROM geometry_columns WHERE lower(f_table_name) = lower("
+			+ SpatiaLiteConnection::quote(table) + ")");
+	db.exec("UPDATE temp.qmicromap_gc SET f_table_name = lower(" + SpatiaLiteConnection::quote(lodTable)
+			+ "), spatial_index_enabled = 0");
+	db.exec("INSERT INTO geometry_columns SELECT * FROM temp.qmicromap_gc");
+	db.exec("DROP TABLE temp.qmicromap_gc");
+
+	// build and populate the R*Tree
+	db.query("SELECT CreateSpatialIndex(" + SpatiaLiteConnection::quote(lodTable) + ", "
+			+ SpatiaLiteConnection::quote(geomColumn) + ")");
+
+	db.exec("INSERT INTO qmicromap_lod (table_name, geometry_column, level, tolerance, lod_table) VALUES ("
+			+ SpatiaLiteConnection::quote(table) + ", "
+			+ SpatiaLiteConnection::quote(geomColumn) + ", "
+			+ lvl.str() + ", "
+			+ tol.str() + ", "
+			+ SpatiaLiteConnection::quote(lodTable) + ")");
+
+	std::vector<SpatiaLiteConnection::Row> size = db.query(
+			"SELECT Count(*), Sum(Length(\"" + geomColumn + "\")) FROM \"" + lodTable + "\"");
+	std::cout << "  " << std::setw(48) << std::left << lodTable
+			<< " tolerance " << std::setw(10) << tolerance
+			<< " rows " << std::setw(8) << size[0][0]
+			<< " bytes " << size[0][1] << std::endl;
+}
+
+////////////////////////////////////////////////////////////////
+int main(int argc, char *argv[]) {
+
+	// The path to the spatialite database
+	std::string dbPath;
+	int levels = 5;
+	double tolerance = 0.01;
+	std::vector<std::string> tables;
+
+	getOptions(argc, argv, dbPath, levels, tolerance, tables);
+
+	try {
+
+		SpatiaLiteConnection db(dbPath, false);
+
+		db.exec("CREATE TABLE IF NOT EXISTS qmicromap_lod ("
+				"table_name TEXT NOT NULL, "
+				"geometry_column TEXT NOT NULL, "
+				"level INTEGER NOT NULL, "
+				"tolerance DOUBLE NOT NULL, "
+				"lod_table TEXT NOT NULL, "
+				"PRIMARY KEY (table_name, level))");
+
+		// find the geometry tables, skipping earlier level of detail copies
+		std::vector<SpatiaLiteConnection::Row> geoTables = db.query(
+				"SELECT f_table_name, f_geometry_column FROM geometry_columns "
+				"WHERE f_table_name NOT LIKE '%\\_\\_lod%' ESCAPE '\\'");
+
+		for (unsigned int i = 0; i < geoTables.size(); i++) {
+
+			std::string table = geoTables[i][0];
+			std::string geomColumn = geoTables[i][1];
+
+			if (tables.size()) {
+				bool wanted = false;
+				for (unsigned int j = 0; j < tables.size(); j++) {
+					wanted = wanted || (tables[j] == table);
+				}
+				if (!wanted) {
+					continue;
+				}
+			}
+
+			// points cannot be simplified
+			std::vector<SpatiaLiteConnection::Row> type = db.query(
+					"SELECT GeometryType(\"" + geomColumn + "\") FROM \"" + table
+					+ "\" WHERE \"" + geomColumn + "\" IS NOT NULL LIMIT 1");
+			if (type.size() == 0 || type[0][0].find("POINT") != std::string::npos) {
+				continue;
+			}
+
+			std::cout << table << " (" << type[0][0] << ")" << std::endl;
+			clock_t t0 = clock();
+
+			db.exec("BEGIN");
+			// lod0 is the coarsest; each following level halves the tolerance
+			for (int level = 0; level < levels; level++) {
+				double levelTol = tolerance * (1 << (levels - 1 - level));
+				makeLod(db, table, geomColumn, level, levelTol);
+			}
+			db.exec("COMMIT");
+
+			std::cout << "  elapsed time: " << (double)(clock() - t0) / CLOCKS_PER_SEC << std::endl;
+		}
+
+	} catch (std::runtime_error& error) {
+		std::cout << error.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -10,11 +10,41 @@ env.Require(qttools)
 
 libsources = env.Split("""
   QMicroMap.cpp
+  QMicroMapLoader.cpp
+  MapLayer.cpp
+  MapLayerCache.cpp
+  MapMetadata.cpp
+  GeometryCache.cpp
+  LayerItem.cpp
+  MappedLayerItem.cpp
+  TilePyramidItem.cpp
+  TileStore.cpp
+  PointTransform.cpp
+  DisplayListItem.cpp
+  TileRasterizer.cpp
+  GraticuleItem.cpp
+  SpatiaLiteDBPool.cpp
+  SpatiaLiteConnection.cpp
   QStationModelGraphicsItem.cpp
 """)
 
 headers = env.Split("""
   QMicroMap.h
+  QMicroMapLoader.h
+  MapLayer.h
+  MapLayerCache.h
+  MapMetadata.h
+  GeometryCache.h
+  LayerItem.h
+  MappedLayerItem.h
+  TilePyramidItem.h
+  TileStore.h
+  PointTransform.h
+  DisplayListItem.h
+  TileRasterizer.h
+  GraticuleItem.h
+  SpatiaLiteDBPool.h
+  SpatiaLiteConnection.h
   QStationModelGraphicsItem.h
   MicroMapOverview.h
 """)